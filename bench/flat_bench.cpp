@@ -0,0 +1,217 @@
+/*
+ * Benchmark for the flat syntax tree of a language called Łukasiewicz,
+ * comparing passes over the table of parallel arrays against the same
+ * passes over the tree of nodes linked by pointers, along with the
+ * memory each of them takes, on a large generated program.
+ *
+ * Authors: Douglas Martins, Gustavo Zambonin,
+ *          Marcello Klingelfus
+ */
+#include "compiler.h"
+#include "flat.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using AST::Flat;
+
+/* What a pass finds: nodes of each kind, the sum of integer literals
+   and the depth of the deepest node. */
+struct Census {
+  std::size_t kinds[AST::FILTER_FUNC_NODE + 1] = {};
+  long long sum = 0;
+  std::size_t depth = 0;
+
+  bool operator==(const Census &o) const {
+    for (int k = 0; k <= AST::FILTER_FUNC_NODE; ++k) {
+      if (kinds[k] != o.kinds[k]) {
+        return false;
+      }
+    }
+    return sum == o.sum && depth == o.depth;
+  }
+};
+
+/* Seconds elapsed since `t`. */
+static double _since(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t)
+      .count();
+}
+
+/* Source of a program with `functions` functions, each of them mixing
+   declarations, arithmetic, branches, loops, calls and functors. */
+static std::string _program(int functions) {
+  std::string out = "int total\nint t[8], m[8]\n";
+  char text[1024];
+  for (int f = 0; f < functions; ++f) {
+    std::snprintf(text, sizeof(text),
+                  "int fun f%d(int a, int b) {\n"
+                  "  int c, d = %d\n"
+                  "  int e[4]\n"
+                  "  float x = 2.5, y\n"
+                  "  char w = 'w'\n"
+                  "  c = a * %d + b - (d / 3)\n"
+                  "  y = x * 2 + [float] c\n"
+                  "  if c > d & !(a == b)\n"
+                  "  then {\n"
+                  "    c = c + 1\n"
+                  "  } else {\n"
+                  "    d = d - [int] y\n"
+                  "  }\n"
+                  "  for d = 0, d < 4, d = d + 1 {\n"
+                  "    e[d] = c + d * 2\n"
+                  "  }\n"
+                  "  ret c + e[1] - -d\n"
+                  "}\n"
+                  "total = total + f%d(%d, total)\n",
+                  f, f % 7, f, f, f);
+    out += text;
+    if (f % 50 == 0) {
+      out += "m = map(lambda int x -> x * 3 + 1, t)\n";
+    }
+  }
+  return out;
+}
+
+/* Counts a subtree, following the pointers of its nodes. */
+static void _walk(AST::Node *n, std::size_t depth, Census &c) {
+  using namespace AST;
+  ++c.kinds[n->kind];
+  c.depth = (depth > c.depth) ? depth : c.depth;
+  ++depth;
+  switch (n->kind) {
+  case INT_NODE:
+    c.sum += static_cast<IntNode *>(n)->value;
+    break;
+  case BINARY_OP_NODE:
+    _walk(static_cast<BinaryOpNode *>(n)->left, depth, c);
+    _walk(static_cast<BinaryOpNode *>(n)->right, depth, c);
+    break;
+  case UNARY_OP_NODE:
+    _walk(static_cast<UnaryOpNode *>(n)->node, depth, c);
+    break;
+  case BLOCK_NODE:
+    for (Node *s : *static_cast<BlockNode *>(n)) {
+      _walk(s, depth, c);
+    }
+    break;
+  case IF_NODE: {
+    auto *i = static_cast<IfNode *>(n);
+    _walk(i->condition, depth, c);
+    _walk(i->_then, depth, c);
+    _walk(i->_else, depth, c);
+    break;
+  }
+  case FOR_NODE: {
+    auto *l = static_cast<ForNode *>(n);
+    _walk(l->assign, depth, c);
+    _walk(l->test, depth, c);
+    _walk(l->iteration, depth, c);
+    _walk(l->body, depth, c);
+    break;
+  }
+  case FUNC_CALL_NODE:
+    for (Node *p : *static_cast<FuncCallNode *>(n)->params) {
+      _walk(p, depth, c);
+    }
+    break;
+  case MESSAGE_NODE:
+    for (Node *d : static_cast<MessageNode *>(n)->line()) {
+      _walk(d, depth, c);
+    }
+    break;
+  case RETURN_NODE:
+    _walk(static_cast<ReturnNode *>(n)->next, depth, c);
+    break;
+  default:
+    if (FuncNode::classof(n)) {
+      auto *f = static_cast<FuncNode *>(n);
+      for (VariableNode *p : f->createDeque()) {
+        _walk(p, depth, c);
+      }
+      if (f->contents != nullptr) {
+        _walk(f->contents, depth, c);
+      }
+    }
+    break;
+  }
+}
+
+/* Counts the table in a single sweep; every parent comes before its
+   children, so their depths are known by the time they are reached. */
+static Census _sweep(const Flat &t, std::vector<std::uint32_t> &depths) {
+  Census c;
+  depths.assign(t.size(), 0);
+  for (Flat::Index i = 0; i < t.size(); ++i) {
+    ++c.kinds[t.kinds[i]];
+    if (t.kinds[i] == AST::INT_NODE) {
+      c.sum += static_cast<std::int32_t>(t.values[i]);
+    }
+    std::uint32_t d = depths[i];
+    c.depth = (d > c.depth) ? d : c.depth;
+    for (Flat::Index j = t.begin(i); j < t.end(i); ++j) {
+      depths[j] = d + 1;
+    }
+  }
+  return c;
+}
+
+int main(int argc, char **argv) {
+  const int functions = (argc > 1) ? std::atoi(argv[1]) : 20000;
+  const int repeat = 5;
+  std::string source = _program(functions);
+  FILE *in = std::tmpfile();
+  std::fwrite(source.data(), 1, source.size(), in);
+  std::rewind(in);
+
+  std::string sink;
+  AST::Writer out(&sink);
+  Compiler c(out);
+  c.parse(in);
+  std::fclose(in);
+  if (c.errors > 0) {
+    std::fprintf(stderr, "generated program has errors\n");
+    return 1;
+  }
+
+  double build = 1e9, tree = 1e9, table = 1e9;
+  Census byTree, byTable;
+  std::vector<std::uint32_t> depths;
+  for (int run = 0; run < repeat; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    Flat t(c.root);
+    double elapsed = _since(start);
+    build = (elapsed < build) ? elapsed : build;
+
+    start = std::chrono::steady_clock::now();
+    byTree = Census();
+    _walk(c.root, 0, byTree);
+    elapsed = _since(start);
+    tree = (elapsed < tree) ? elapsed : tree;
+
+    start = std::chrono::steady_clock::now();
+    byTable = _sweep(t, depths);
+    elapsed = _since(start);
+    table = (elapsed < table) ? elapsed : table;
+  }
+
+  Flat t(c.root);
+  double mb = 1024.0 * 1024.0;
+  std::printf("%zu bytes of source, %u nodes\n", source.size(), t.size());
+  std::printf("%-8s %12s %12s\n", "", "pass", "memory");
+  std::printf("%-8s %10.3f ms %9.2f MB\n", "tree", tree * 1e3,
+              c.arena.bytes() / mb);
+  std::printf("%-8s %10.3f ms %9.2f MB\n", "table", table * 1e3,
+              t.bytes() / mb);
+  std::printf("%-8s %10.2fx %10.2fx\n", "ratio", tree / table,
+              static_cast<double>(c.arena.bytes()) / t.bytes());
+  std::printf("table built in %.3f ms\n", build * 1e3);
+
+  if (!(byTree == byTable)) {
+    std::printf("FAIL passes disagree\n");
+    return 1;
+  }
+  return 0;
+}
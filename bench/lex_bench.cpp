@@ -0,0 +1,89 @@
+/*
+ * Microbenchmark for the scanners of a language called Łukasiewicz,
+ * measuring tokens per second on a large generated source. It is
+ * linked once against the flex scanner and once against the
+ * hand-written one.
+ *
+ * Authors: Douglas Martins, Gustavo Zambonin,
+ *          Marcello Klingelfus
+ */
+#include "compiler.h"
+#include "parser.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+extern int yylex(YYSTYPE *lvalp, yyscan_t scanner);
+
+/* Seconds elapsed since `t`. */
+static double _since(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t)
+      .count();
+}
+
+/* Source of roughly `size` bytes mixing every kind of token. */
+static std::string _corpus(std::size_t size) {
+  static const char *lines[] = {
+      "int a%d, b%d, c%d\n",
+      "float f%d = 1.5\n",
+      "a%d = b%d + c%d * 42 - (a%d / 7)\n",
+      "if a%d >= b%d & !(c%d == 3) then {\n  ret true\n} else {\n"
+      "  ret false\n}\n",
+      "# keeps count of the values seen so far, %d of them\n",
+      "for i%d = 0, i%d < 10, i%d = i%d + 1 {\n    s%d = s%d <- 'x'\n}\n",
+      "char word%d = \"some text\"\n",
+      "x%d = [int] f%d + [len] word%d\n",
+      "ref int p%d = addr a%d\n",
+      "int array v%d[8] = map(v%d, sq)\n",
+      "fun g%d(int n, float m) -> bool {\n\tret n != 0 | m <= 2.\n}\n"};
+  const int count = sizeof(lines) / sizeof(lines[0]);
+
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> pick(0, count - 1);
+  std::string out;
+  char line[256];
+  while (out.size() < size) {
+    int n = rng() % 1000;
+    std::snprintf(line, sizeof(line), lines[pick(rng)], n, n, n, n, n, n);
+    out += line;
+  }
+  return out;
+}
+
+int main(int argc, char **argv) {
+  const std::size_t size = (argc > 1) ? std::atol(argv[1]) : 32 << 20;
+  std::string source = _corpus(size);
+  std::vector<char> buffer(source.begin(), source.end());
+  buffer.resize(buffer.size() + 2, '\0');
+
+  // the scanner needs a compilation to intern names into
+  std::string sink;
+  AST::Writer out(&sink);
+  Compiler c(out);
+  compiler = &c;
+  arena = &c.arena;
+  names = &c.names;
+  output = &out;
+
+  double best = 1e9;
+  std::size_t tokens = 0;
+  for (int run = 0; run < 3; ++run) {
+    scan_buffer(buffer.data(), buffer.size(), c.scanner);
+    YYSTYPE value;
+    tokens = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (yylex(&value, c.scanner) != 0) {
+      ++tokens;
+    }
+    double elapsed = _since(start);
+    best = (elapsed < best) ? elapsed : best;
+  }
+
+  std::printf("%zu bytes, %zu tokens in %.3f s: %.1f Mtokens/s, %.0f MB/s\n",
+              source.size(), tokens, best, tokens / best / 1e6,
+              source.size() / best / 1e6);
+  return 0;
+}
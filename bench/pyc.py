@@ -0,0 +1,98 @@
+"""Times the startup of the Python emitted for the valid corpus and for a
+large generated program, run from its source and from the `.pyc` that
+--pyc writes, which CPython loads without parsing or compiling. The
+`.pyc` must hold the very code object that CPython compiles from the
+source, under the magic number of this interpreter."""
+
+import glob
+import importlib.util
+import marshal
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+compiler = os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else "lukacompiler")
+lines = int(sys.argv[2]) if len(sys.argv) > 2 else 20000
+repeat = 5
+
+
+def generated():
+    """Source of a program with `lines` lines or so, spread over many
+    small functions that are defined but mostly never called, so that its
+    run time is mostly spent parsing and compiling."""
+    out = ["int total\n"]
+    for f in range(lines // 10):
+        out.append("int fun f%d(int a, int b) {\n" % f)
+        out.append("  int c, d\n")
+        out.append("  c = a * %d + b\n" % f)
+        out.append("  d = c - a / 2\n")
+        out.append("  if c > d\n  then {\n    c = c + 1\n  }\n")
+        out.append("  ret c + d\n}\n")
+        if f % 100 == 0:
+            out.append("total = total + f%d(%d, 1)\n" % (f, f))
+    return "".join(out)
+
+
+def translate(source, flags, path):
+    """Translates a program into a file, returning false if it fails."""
+    with open(path, "wb") as f:
+        done = subprocess.run([compiler] + flags, input=source.encode(),
+                              stdout=f, stderr=subprocess.DEVNULL)
+    return done.returncode == 0 and os.path.getsize(path) > 0
+
+
+def same(py, pyc):
+    """Whether a `.pyc` holds the code object compiled from a source."""
+    with open(py) as f:
+        code = compile(f.read(), "<stdin>", "exec")
+    with open(pyc, "rb") as f:
+        data = f.read()
+    return (data[:4] == importlib.util.MAGIC_NUMBER
+            and marshal.loads(data[16:]) == code)
+
+
+def run(path):
+    """Runs a file `repeat` times, returning the best time."""
+    best = None
+    for _ in range(repeat):
+        start = time.perf_counter()
+        subprocess.run([sys.executable, path], stdout=subprocess.DEVNULL,
+                       check=True)
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+    return best
+
+
+programs = [(os.path.relpath(f, "test/valid"), open(f).read())
+            for f in sorted(glob.glob("test/valid/*/*.in"))]
+programs.append(("generated", generated()))
+
+failed = []
+total = [0.0, 0.0]
+with tempfile.TemporaryDirectory() as tmp:
+    py, pyc = os.path.join(tmp, "main.py"), os.path.join(tmp, "main.pyc")
+    if not translate("int a\n", ["--pyc"], pyc):
+        print("%s cannot write .pyc files; build it with `make PYC=yes`"
+              % compiler)
+        sys.exit(1)
+    print("%-24s %10s %10s %9s %9s %8s" % ("program", ".py", ".pyc",
+                                           "py size", "pyc size", "speedup"))
+    for name, source in programs:
+        if (not translate(source, ["-p"], py)
+                or not translate(source, ["--pyc"], pyc) or not same(py, pyc)):
+            failed.append(name)
+            continue
+        times = [run(py), run(pyc)]
+        total[0] += times[0]
+        total[1] += times[1]
+        print("%-24s %9.4fs %9.4fs %8dB %8dB %7.2fx"
+              % (name, times[0], times[1], os.path.getsize(py),
+                 os.path.getsize(pyc), times[0] / times[1]))
+print("%-24s %9.4fs %9.4fs %28.2fx" % ("total", total[0], total[1],
+                                       total[0] / total[1]))
+for name in failed:
+    print("FAIL " + name)
+
+sys.exit(1 if failed else 0)
@@ -0,0 +1,128 @@
+"""Times the Python code emitted for the valid corpus, scaled up, and for
+a few larger kernels, written plainly, with --idiomatic and also with
+--typed-arrays, whose peak memory is compared to the plain one. Every
+version must run to the same final values."""
+
+import glob
+import os
+import re
+import subprocess
+import sys
+
+compiler = os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else "lukacompiler")
+scale = int(sys.argv[2]) if len(sys.argv) > 2 else 20000
+
+# the program times itself and reads its peak memory as soon as it is
+# done, and then prints every variable, arrays and strings as lists and
+# booleans as integers; names of the language never start with `_`
+start = "_start = __import__('time').perf_counter()\n"
+dump = """
+    _elapsed = __import__("time").perf_counter() - _start
+    with open("/proc/self/status") as _status:
+        _peak = [l.split()[1] for l in _status if l.startswith("VmHWM")][0]
+    def _value(v):
+        if isinstance(v, str):
+            return list(v)
+        if isinstance(v, list) or type(v).__name__ == "array":
+            return [_value(x) for x in v]
+        return int(v) if isinstance(v, bool) else v
+    print(sorted((k, _value(v)) for k, v in locals().items()
+                 if not k.startswith("_") and not callable(v)))
+    __import__("sys").stderr.write("%f %s" % (_elapsed, _peak))
+
+main()"""
+
+modes = [("plain", []), ("idiomatic", ["--idiomatic"]),
+         ("typed", ["--idiomatic", "--typed-arrays"])]
+
+kernels = {
+    "append": """int g[0]
+int i
+for i = 0, i < %d, i = i + 1 {
+  g <- i
+}
+""" % scale,
+    "functors": """int t[%d], m[%d], f[%d]
+int i, s
+for i = 0, i < %d, i = i + 1 {
+  t[i] = i
+}
+m = map(lambda int x -> x * 3, t)
+f = filter(lambda int x -> x > 10, m)
+s = fold(lambda int x, y -> y, f)
+""" % (scale, scale, scale, scale),
+    "large arrays": """int t[%d], u[%d]
+int i, s
+for i = 0, i < %d, i = i + 1 {
+  t[i] = i
+}
+u = t
+for i = 0, i < %d, i = i + 1 {
+  s = s + u[i] * 2
+}
+""" % (scale * 100, scale * 100, scale * 100, scale * 100),
+    "nested loops": """int i, j, s
+for i = 0, i < %d, i = i + 1 {
+  for j = 0, j <= 100, j = j + 1 {
+    s = s + i * j
+  }
+}
+""" % (scale // 10),
+}
+
+
+def scaled(path):
+    """Source of a test program whose arrays and loops are `scale` times
+    longer."""
+    lines = []
+    with open(path) as f:
+        for line in f:
+            if re.match(r"\s*(int|float|bool|char)\b", line):
+                line = re.sub(r"\[(\d+)\]",
+                              lambda m: "[%d]" % (int(m.group(1)) * scale),
+                              line)
+            elif re.match(r"\s*for\b", line):
+                line = re.sub(r"(<=?) (\d+)", lambda m: "%s %d" % (
+                    m.group(1), int(m.group(2)) * scale), line)
+            lines.append(line)
+    return "".join(lines)
+
+
+def run(source, flags):
+    """Translates a program and runs it, returning the time it took, the
+    final values of its variables and its peak memory in kilobytes."""
+    code = subprocess.run([compiler, "-p"] + flags, input=source.encode(),
+                          stdout=subprocess.PIPE, stderr=subprocess.DEVNULL,
+                          check=True).stdout.decode()
+    code = start + code.replace("\n\n\nmain()", dump)
+    done = subprocess.run([sys.executable, "-c", code], stdout=subprocess.PIPE,
+                          stderr=subprocess.PIPE, check=True)
+    elapsed, peak = done.stderr.split()
+    return float(elapsed), done.stdout, int(peak)
+
+
+programs = [(os.path.relpath(f, "test/valid"), scaled(f))
+            for f in sorted(glob.glob("test/valid/*/*.in"))]
+programs += sorted(kernels.items())
+
+failed = []
+total = [0.0] * len(modes)
+row = "%-24s" + " %9.3fs" * len(modes) + " %7.2fx %8dK %8dK"
+print(("%-24s" + " %10s" * len(modes) + " %8s %9s %9s")
+      % (("program",) + tuple(m for m, _ in modes)
+         + ("speedup", "plain", "typed")))
+for name, source in programs:
+    runs = [run(source, flags) for _, flags in modes]
+    if any(r[1] != runs[0][1] for r in runs):
+        failed.append(name)
+    for i, r in enumerate(runs):
+        total[i] += r[0]
+    print(row % ((name,) + tuple(r[0] for r in runs)
+                 + (runs[0][0] / max(runs[-1][0], 1e-6), runs[0][2],
+                    runs[-1][2])))
+print(("%-24s" + " %9.3fs" * len(modes) + " %7.2fx")
+      % (("total",) + tuple(total) + (total[0] / total[-1],)))
+for name in failed:
+    print("FAIL " + name)
+
+sys.exit(1 if failed else 0)
@@ -0,0 +1,91 @@
+"""Runs the test corpus through a resident compile server, checking every
+answer against the expected output, and times it against compiling each
+file in a fresh process."""
+
+import glob
+import os
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+# flags of a request, as in include/server.h
+PYTHON = 1
+
+compiler = os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else "lukacompiler")
+valid = sorted(glob.glob("test/valid/*/*.in"))
+invalid = sorted(glob.glob("test/invalid/*/*.in"))
+
+
+def read(path):
+    with open(path, "rb") as f:
+        return f.read()
+
+
+def recv(conn, n):
+    data = b""
+    while len(data) < n:
+        chunk = conn.recv(n - len(data))
+        if not chunk:
+            raise EOFError("server closed the connection")
+        data += chunk
+    return data
+
+
+def request(conn, source, flags=0):
+    conn.sendall(struct.pack("=II", flags, len(source)) + source)
+    code, diagnostics = struct.unpack("=II", recv(conn, 8))
+    return recv(conn, code), recv(conn, diagnostics)
+
+
+def timed(name, files, run):
+    start = time.time()
+    for f in files:
+        run(f)
+    elapsed = time.time() - start
+    print("%-24s %6d files %8.3f s %10.0f files/s"
+          % (name, len(files), elapsed, len(files) / elapsed))
+
+
+path = os.path.join(tempfile.mkdtemp(), "luka.sock")
+server = subprocess.Popen([compiler, "--serve", path])
+try:
+    while not os.path.exists(path):
+        time.sleep(0.01)
+    conn = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    conn.connect(path)
+
+    failed = []
+    for f in valid:
+        if request(conn, read(f))[0] != read(f[:-3] + ".out"):
+            failed.append(f)
+    for f in invalid:
+        if request(conn, read(f))[1] != read(f[:-3] + ".out"):
+            failed.append(f)
+    # Python after every other request, so that each compilation starts
+    # on memory left behind by the ones before it
+    for f in valid:
+        local = subprocess.run([compiler, "-p"], stdin=open(f),
+                               stdout=subprocess.PIPE).stdout
+        if request(conn, read(f), PYTHON)[0] != local:
+            failed.append(f + " (-p)")
+    for f in failed:
+        print("FAIL " + f)
+
+    corpus = (valid + invalid) * 20
+    timed("fork per file", corpus, lambda f: subprocess.run(
+        [compiler], stdin=open(f), stdout=subprocess.DEVNULL,
+        stderr=subprocess.DEVNULL))
+    timed("client per file", corpus, lambda f: subprocess.run(
+        [compiler, "--connect", path, f], stdout=subprocess.DEVNULL,
+        stderr=subprocess.DEVNULL))
+    timed("persistent connection", corpus, lambda f: request(conn, read(f)))
+    conn.close()
+finally:
+    server.terminate()
+    server.wait()
+    os.unlink(path)
+
+sys.exit(1 if failed else 0)
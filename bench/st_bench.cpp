@@ -0,0 +1,107 @@
+/*
+ * Microbenchmark for the symbol table of a language called
+ * Łukasiewicz, comparing the flat scoped hash table against the
+ * previous design, a chain of `std::map` tables linked by scope.
+ *
+ * Authors: Douglas Martins, Gustavo Zambonin,
+ *          Marcello Klingelfus
+ */
+#include "scope.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+/* Previous symbol table, one `std::map` per scope linked to its parent. */
+struct ChainTable {
+  std::map<ST::SymbolType, std::map<std::string, void *>> entryList;
+  ChainTable *external;
+
+  explicit ChainTable(ChainTable *external) : external(external) {}
+
+  bool symbolExistsHere(ST::SymbolType type, const std::string &key) {
+    return entryList[type].count(key) == 1;
+  }
+
+  void *find(ST::SymbolType type, const std::string &key) {
+    if (symbolExistsHere(type, key)) {
+      return entryList[type][key];
+    }
+    return (external == nullptr) ? nullptr : external->find(type, key);
+  }
+};
+
+/* Seconds elapsed since `t`. */
+static double _since(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t)
+      .count();
+}
+
+int main(int argc, char **argv) {
+  const int names = 512, perScope = 8;
+  const long lookups = (argc > 1) ? std::atol(argv[1]) : 2000000;
+
+  AST::Interner table;
+  std::vector<std::string> text;
+  std::vector<AST::Name> interned;
+  for (int i = 0; i < names; ++i) {
+    text.push_back("var_" + std::to_string(i));
+    interned.push_back(table.intern(text.back().data(), text.back().size()));
+  }
+
+  std::printf("%6s %16s %16s %8s\n", "depth", "map chain ns/op",
+              "flat hash ns/op", "speedup");
+
+  for (int depth : {1, 4, 16, 64}) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> pick(0, depth * perScope - 1);
+    std::vector<int> keys(lookups);
+    for (int &k : keys) {
+      k = pick(rng) % names;
+    }
+
+    // every scope declares its own slice of names, the innermost
+    // one shadowing whatever was declared outside
+    std::vector<ChainTable *> chain;
+    ST::Scopes flat;
+    int value = 0;
+    for (int d = 0; d < depth; ++d) {
+      chain.push_back(new ChainTable(chain.empty() ? nullptr : chain.back()));
+      flat.open();
+      for (int j = 0; j < perScope; ++j) {
+        int n = (d * perScope + j) % names;
+        chain.back()->entryList[ST::variable][text[n]] = &value;
+        flat.bind(ST::variable, interned[n], &value);
+      }
+    }
+
+    std::size_t hits = 0;
+    auto t = std::chrono::steady_clock::now();
+    for (int k : keys) {
+      hits += (chain.back()->find(ST::variable, text[k]) != nullptr);
+    }
+    double chainTime = _since(t);
+
+    t = std::chrono::steady_clock::now();
+    for (int k : keys) {
+      hits += (flat.find(ST::variable, interned[k]) != nullptr);
+    }
+    double flatTime = _since(t);
+
+    std::printf("%6d %16.1f %16.1f %7.1fx\n", depth, 1e9 * chainTime / lookups,
+                1e9 * flatTime / lookups, chainTime / flatTime);
+
+    for (ChainTable *c : chain) {
+      delete c;
+    }
+    if (hits != 2 * static_cast<std::size_t>(lookups)) {
+      std::fprintf(stderr, "lookups disagree\n");
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,157 @@
+/*!
+ * Region allocator for the abstract syntax tree of a language
+ * called Łukasiewicz, based on prefix notation.
+ *
+ *  \author Douglas Martins, Gustavo Zambonin, Marcello Klingelfus
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace AST {
+
+class Node;
+
+//! Bump allocator that owns every node built during a compilation. Nodes
+//! are carved out of large blocks and never freed individually; releasing
+//! the arena runs their destructors and returns all blocks at once.
+class Arena {
+public:
+  //! Basic constructor.
+  /*!
+   *  \param blockSize  size in bytes of each block requested from the heap.
+   */
+  explicit Arena(std::size_t blockSize = 64 * 1024) : blockSize(blockSize) {}
+
+  //! Basic destructor; releases every object still owned by the arena.
+  ~Arena();
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  //! Returns raw storage that lives as long as the arena.
+  /*!
+   *  \param size     number of bytes requested.
+   */
+  void *allocate(std::size_t size);
+
+  //! Returns storage for a node, whose destructor will be run on release.
+  /*!
+   *  \param size     size of the node object.
+   */
+  void *allocateNode(std::size_t size);
+
+  //! Copies a sequence of characters to storage that lives as long as
+  //! the arena, followed by a number of null bytes.
+  /*!
+   *  \param s        first character of the sequence.
+   *  \param n        length of the sequence.
+   *  \param pad      number of null bytes appended.
+   */
+  char *copy(const char *s, std::size_t n, std::size_t pad = 0);
+
+  //! Destroys every node and frees every block owned by the arena.
+  void release();
+
+  //! Point of the arena to which it may be rewound.
+  struct Mark {
+    std::size_t blocks, owned, allocated;
+    char *cursor, *limit;
+  };
+
+  //! Returns the current point of the arena.
+  Mark mark() const {
+    return {blocks.size(), owned.size(), allocated, cursor, limit};
+  }
+
+  //! Destroys every node allocated since a mark and frees every block
+  //! requested since, so that the storage is handed out again.
+  /*!
+   *  \param m        point taken by `mark`, with nothing released since.
+   */
+  void rewind(const Mark &m);
+
+  //! Number of bytes currently handed out by the arena.
+  std::size_t bytes() const { return allocated; }
+
+  //! Number of nodes currently owned by the arena.
+  std::size_t nodes() const { return owned.size(); }
+
+  //! Every node currently owned by the arena, in construction order.
+  const std::vector<Node *> &ownedNodes() const { return owned; }
+
+private:
+  //! Size in bytes of each regular block.
+  std::size_t blockSize;
+
+  //! Every block requested from the heap, in order.
+  std::vector<char *> blocks;
+
+  //! Every node allocated on the arena, in construction order.
+  std::vector<Node *> owned;
+
+  //! Bump pointer and limit of the current block.
+  char *cursor = nullptr, *limit = nullptr;
+
+  //! Total of bytes handed out.
+  std::size_t allocated = 0;
+};
+
+} // namespace AST
+
+//! Arena of the compilation bound to the current thread.
+extern thread_local AST::Arena *arena;
+
+namespace AST {
+
+//! Contiguous array carved out of the arena bound to the current thread,
+//! which takes no storage until its first item. Outgrowing its storage
+//! moves the items to a block twice as large, leaving the old one to the
+//! arena; items are copied as plain bytes.
+template <typename T> class Array {
+public:
+  //! Appends an item.
+  void push(const T &item) {
+    if (used == capacity) {
+      capacity = (capacity > 0) ? 2 * capacity : 2;
+      T *moved = static_cast<T *>(::arena->allocate(capacity * sizeof(T)));
+      if (used > 0) {
+        std::memcpy(static_cast<void *>(moved), items, used * sizeof(T));
+      }
+      items = moved;
+    }
+    items[used++] = item;
+  }
+
+  //! Forgets every item along with their storage, which stays with the
+  //! arena, so that the array may outlive a rewind past it.
+  void clear() {
+    items = nullptr;
+    used = capacity = 0;
+  }
+
+  //! Keeps only the first items, leaving the rest of the storage unused.
+  /*!
+   *  \param n        number of items kept, no more than there are.
+   */
+  void truncate(std::size_t n) { used = static_cast<std::uint32_t>(n); }
+
+  //! Number of items.
+  std::size_t size() const { return used; }
+
+  //! Item at a position.
+  T &operator[](std::size_t i) const { return items[i]; }
+
+  //! Bounds of the items.
+  T *begin() const { return items; }
+  T *end() const { return items + used; }
+
+private:
+  T *items = nullptr;
+  std::uint32_t used = 0, capacity = 0;
+};
+
+} // namespace AST
@@ -6,11 +6,17 @@
  */
 #pragma once
 
+#include "arena.h"
+#include "intern.h"
+#include "output.h"
 #include <deque>
-#include <iostream>
-#include <sstream>
+#include <string>
 #include <vector>
 
+namespace VM {
+class Builder;
+}
+
 namespace AST {
 
 //! Checks if a node is an array.
@@ -68,8 +74,39 @@ enum NodeType {
   PA_CHAR,
 };
 
+//! Concrete class of a node, so that type tests are integer comparisons.
+//! Subclasses of a class are numbered contiguously after it, which turns
+//! every `classof` test into a range check.
+enum NodeKind {
+  BASE_NODE,
+  INT_NODE,
+  FLOAT_NODE,
+  BOOL_NODE,
+  CHAR_NODE,
+  BINARY_OP_NODE,
+  UNARY_OP_NODE,
+  VAR_REF_NODE,
+  BLOCK_NODE,
+  IF_NODE,
+  FOR_NODE,
+  FUNC_CALL_NODE,
+  MESSAGE_NODE,
+  RETURN_NODE,
+  VARIABLE_NODE,
+  PARAM_NODE,
+  DECLARATION_NODE,
+  FUNC_NODE,
+  HI_ORD_FUNC_NODE,
+  MAP_FUNC_NODE,
+  FOLD_FUNC_NODE,
+  FILTER_FUNC_NODE
+};
+
 class Node {
 public:
+  //! Concrete class of the node.
+  NodeKind kind = BASE_NODE;
+
   //! Type of the node.
   NodeType type = ND;
 
@@ -79,9 +116,19 @@ public:
   //! Basic constructor that also sets the type of the node.
   explicit Node(int);
 
+  //! Constructor used by subclasses to tag their concrete class.
+  explicit Node(NodeKind kind, int type = ND);
+
   //! Basic destructor.
   virtual ~Node() = default;
 
+  //! Nodes are carved out of the arena of the current compilation, and
+  //! are only freed when the whole arena is released.
+  static void *operator new(std::size_t size) {
+    return arena->allocateNode(size);
+  }
+  static void operator delete(void *) {}
+
   //! Simplest type of printing, in usual notation.
   virtual void printInfix() {}
 
@@ -91,18 +138,26 @@ public:
   //! Prints Python code representing the node.
   virtual void printPython() {}
 
+  //! Prints C code representing the node.
+  virtual void printC() {}
+
+  //! Lowers the node to bytecode, returning the register that holds its
+  //! value, or -1 if it has none.
+  virtual int lower(VM::Builder &) { return -1; }
+
   //! Error handler logic. Note that this function is called in the
   //! end of every constructor, and that is desired behaviour, since
   //! all error handlers must be executed (including the parent classes').
   virtual void error_handler() {}
 
-  //! Returns the type of the node.
-  virtual NodeType _type() { return this->type; }
+  //! Returns the type of the node, which every constructor computes
+  //! once from its children, so reading it never recurses.
+  NodeType _type() const { return this->type; }
 
   //! Prints the verbose type of the node, taking in account its
   //! status as an array and/or pointer. A boolean parameter decides
   //! if a shorter version of the type is returned.
-  std::string _vtype(bool);
+  std::string _vtype(bool) const;
 };
 
 class IntNode : public Node {
@@ -111,24 +166,36 @@ public:
   int value;
 
   //! Basic constructor that also sets the type of the node.
-  explicit IntNode(int value) : Node(0), value(value) {}
+  explicit IntNode(int value) : Node(INT_NODE, 0), value(value) {}
+
+  static bool classof(const Node *n) { return n->kind == INT_NODE; }
 
   //! Available print methods.
   void printInfix() override;
   void printPython() override;
+  void printC() override;
+
+  //! Lowers the node to bytecode.
+  int lower(VM::Builder &) override;
 };
 
 class FloatNode : public Node {
 public:
   //! String value of the node, displaying exactly the user input.
-  std::string value;
+  View value;
 
   //! Basic constructor that also sets the type of the node.
-  explicit FloatNode(std::string value) : Node(1), value(value) {}
+  explicit FloatNode(View value) : Node(FLOAT_NODE, 1), value(value) {}
+
+  static bool classof(const Node *n) { return n->kind == FLOAT_NODE; }
 
   //! Available print methods.
   void printInfix() override;
   void printPython() override;
+  void printC() override;
+
+  //! Lowers the node to bytecode.
+  int lower(VM::Builder &) override;
 };
 
 class BoolNode : public Node {
@@ -137,27 +204,38 @@ public:
   bool value;
 
   //! Basic constructor that also sets the type of the node.
-  explicit BoolNode(bool value) : Node(2), value(value) {}
+  explicit BoolNode(bool value) : Node(BOOL_NODE, 2), value(value) {}
+
+  static bool classof(const Node *n) { return n->kind == BOOL_NODE; }
 
   //! Available print methods.
   void printInfix() override;
   void printPython() override;
+  void printC() override;
+
+  //! Lowers the node to bytecode.
+  int lower(VM::Builder &) override;
 };
 
 class CharNode : public Node {
 public:
   //! String value of the node, displaying exactly the user input.
-  std::string value;
+  View value;
 
-  //! Basic constructor that also sets the type of the node.
-  explicit CharNode(std::string value) : Node(3), value(value) {}
+  //! Basic constructor that also sets the type of the node, which is
+  //! a char array if the word starts with double quotes.
+  explicit CharNode(View value)
+      : Node(CHAR_NODE, (value.data[0] == '"') ? A_CHAR : CHAR), value(value) {}
+
+  static bool classof(const Node *n) { return n->kind == CHAR_NODE; }
 
   //! Available print methods.
   void printInfix() override;
   void printPython() override;
+  void printC() override;
 
-  //! Returns a char array if the word starts with double quotes.
-  NodeType _type() override;
+  //! Lowers the node to bytecode.
+  int lower(VM::Builder &) override;
 };
 
 class BinaryOpNode : public Node {
@@ -171,25 +249,34 @@ public:
   //! Right operand or right child of the node.
   Node *right;
 
-  //! Basic constructor that also enforces coercion.
+  //! Basic constructor that also enforces coercion. The type of the node
+  //! is that of the left child if the operation is arithmetic or an
+  //! assignment/indexing, and a boolean type otherwise.
   BinaryOpNode(Operation, Node *, Node *);
 
-  //! Basic destructor.
-  ~BinaryOpNode() override;
+  static bool classof(const Node *n) { return n->kind == BINARY_OP_NODE; }
 
   //! Available print methods.
   void printInfix() override;
   void printPrefix() override;
   void printPython() override;
+  void printC() override;
+
+  //! Lowers the node to bytecode.
+  int lower(VM::Builder &) override;
+
+  //! Lowers the operation itself, once its operands are lowered.
+  /*!
+   *  \param b        builder of the bytecode.
+   *  \param l        register holding the left operand.
+   *  \param r        register holding the right operand.
+   */
+  int operate(VM::Builder &b, int l, int r);
 
   //! Error handler logic; checks for mismatched array sizes, truncates
   //! strings that are too big and general misuse of operations between
   //! different types.
   void error_handler() override;
-
-  //! Returns the type of the left child if the operation is arithmetic
-  //! or an assignment/indexing, and a boolean type otherwise.
-  NodeType _type() override;
 };
 
 class UnaryOpNode : public Node {
@@ -203,13 +290,24 @@ public:
   //! Basic constructor that also sets the type of this node.
   UnaryOpNode(Operation, Node *);
 
-  //! Basic destructor.
-  ~UnaryOpNode() override;
+  static bool classof(const Node *n) { return n->kind == UNARY_OP_NODE; }
 
   //! Available print methods.
   void printInfix() override;
   void printPrefix() override;
   void printPython() override;
+  void printC() override;
+
+  //! Lowers the node to bytecode.
+  int lower(VM::Builder &) override;
+
+  //! Lowers the operation itself, once its operand is lowered.
+  /*!
+   *  \param b        builder of the bytecode.
+   *  \param n        register holding the operand.
+   *  \param mark     registers in use before the operand was lowered.
+   */
+  int operate(VM::Builder &b, int n, int mark);
 
   //! Error handler logic; checks if nodes are valid children to their
   //! operator parents.
@@ -222,16 +320,18 @@ public:
   Node *next;
 
   //! Basic constructor.
-  LinkedNode(Node *next, int type) : Node(type), next(next) {}
+  LinkedNode(NodeKind kind, Node *next, int type)
+      : Node(kind, type), next(next) {}
 
-  //! Basic destructor.
-  ~LinkedNode() override;
+  static bool classof(const Node *n) {
+    return n->kind >= MESSAGE_NODE && n->kind <= DECLARATION_NODE;
+  }
 };
 
 class VariableNode : public LinkedNode {
 public:
   //! Name of the variable.
-  std::string id;
+  Name id;
 
   //! Length of the array if applicable.
   unsigned int size;
@@ -240,41 +340,176 @@ public:
   bool init;
 
   //! Basic constructor.
-  VariableNode(std::string id, Node *next, int type, int size)
-      : LinkedNode(next, type), id(id), size(size) {}
+  VariableNode(Name id, Node *next, int type, int size)
+      : VariableNode(VARIABLE_NODE, id, next, type, size) {}
+
+  static bool classof(const Node *n) {
+    return n->kind >= VARIABLE_NODE && n->kind <= DECLARATION_NODE;
+  }
+
+  //! Available print methods.
+  void printInfix() override;
+  void printPython() override;
+
+protected:
+  //! Constructor used by subclasses to tag their concrete class.
+  VariableNode(NodeKind kind, Name id, Node *next, int type, int size)
+      : LinkedNode(kind, next, type), id(id), size(size), init(false) {}
+};
+
+class VarRefNode : public Node {
+public:
+  //! Declaration of the variable being used.
+  VariableNode *decl;
+
+  //! Basic constructor; the type is that of the declaration.
+  explicit VarRefNode(VariableNode *decl)
+      : Node(VAR_REF_NODE, decl->type), decl(decl) {}
+
+  static bool classof(const Node *n) { return n->kind == VAR_REF_NODE; }
 
   //! Available print methods.
   void printInfix() override;
   void printPython() override;
+  void printC() override;
+
+  //! Lowers the node to bytecode.
+  int lower(VM::Builder &) override;
 };
 
 class BlockNode : public Node {
 public:
-  //! List of nodes that can be seen as lines of the program.
-  std::vector<Node *> nodeList;
+  //! Functor that the parser hoisted out of a line, written right before
+  //! the statement at `before`.
+  struct Hoist {
+    std::uint32_t before;
+    Node *functor;
+  };
+
+  //! Walks the statements and the hoisted functors in the order of the
+  //! source, each functor coming before the statement it was taken from.
+  class Iterator {
+  public:
+    Iterator(const BlockNode *b, std::uint32_t s, std::uint32_t h)
+        : b(b), s(s), h(h) {}
+
+    Node *operator*() const {
+      return hoisting() ? b->hoisted[h].functor : b->statements[s];
+    }
+
+    Iterator &operator++() {
+      if (hoisting()) {
+        ++h;
+      } else {
+        ++s;
+      }
+      return *this;
+    }
+
+    bool operator!=(const Iterator &o) const { return s != o.s || h != o.h; }
+
+  private:
+    const BlockNode *b;
+    std::uint32_t s, h;
+
+    //! Whether a functor comes before the current statement.
+    bool hoisting() const {
+      return h < b->hoisted.size() && b->hoisted[h].before == s;
+    }
+  };
 
   //! Default constructor.
-  BlockNode() {}
+  BlockNode() : Node(BLOCK_NODE) {}
 
-  //! Basic constructor that also pushes a node to `nodeList`.
+  //! Basic constructor that also appends a statement.
   BlockNode(Node *);
 
-  //! Basic destructor.
-  ~BlockNode() override;
+  static bool classof(const Node *n) { return n->kind == BLOCK_NODE; }
+
+  //! Appends a statement, unless it is null.
+  void push(Node *n) {
+    if (n != nullptr) {
+      statements.push(n);
+    }
+  }
+
+  //! Hoists a functor before the next statement, unless it is null.
+  void hoist(Node *f) {
+    if (f != nullptr) {
+      hoisted.push({static_cast<std::uint32_t>(statements.size()), f});
+    }
+  }
+
+  //! Forgets every statement and functor, along with their storage.
+  void clear() {
+    statements.clear();
+    hoisted.clear();
+  }
+
+  //! Replaces the statement at a position; one replaced by null is only
+  //! dropped by `compact`.
+  void replace(std::size_t i, Node *n) { statements[i] = n; }
+
+  //! Drops the statements replaced by null. Each hoisted functor stays
+  //! before the statement it came before, or the next one kept.
+  void compact();
+
+  //! Number of statements, functors aside.
+  std::size_t size() const { return statements.size(); }
+
+  //! Statement at a position.
+  Node *operator[](std::size_t i) const { return statements[i]; }
+
+  //! First and last statements, or null if there are none.
+  Node *front() const { return size() > 0 ? statements[0] : nullptr; }
+  Node *back() const { return size() > 0 ? statements[size() - 1] : nullptr; }
+
+  //! Whether there are neither statements nor functors.
+  bool empty() const { return size() == 0 && hoisted.size() == 0; }
+
+  //! Bounds of the statements and functors.
+  Iterator begin() const { return Iterator(this, 0, 0); }
+  Iterator end() const {
+    return Iterator(this, static_cast<std::uint32_t>(statements.size()),
+                    static_cast<std::uint32_t>(hoisted.size()));
+  }
 
   //! Available print methods.
   void printPrefix() override;
   void printPython() override;
+  void printC() override;
+
+  //! Lowers the node to bytecode.
+  int lower(VM::Builder &) override;
+
+private:
+  //! Lines of the block that hold a statement, on the arena.
+  Array<Node *> statements;
+
+  //! Functors hoisted out of the statements, by position, on the arena.
+  Array<Hoist> hoisted;
 };
 
 class MessageNode : public LinkedNode {
 public:
   //! Basic constructor.
-  using LinkedNode::LinkedNode;
+  MessageNode(Node *next, int type) : LinkedNode(MESSAGE_NODE, next, type) {}
+
+  static bool classof(const Node *n) { return n->kind == MESSAGE_NODE; }
+
+  //! Declarations of the line, from first to last, each the variable or
+  //! the assignment that initializes it. They are chained backwards from
+  //! `next`, and gathered in a loop so that lines of any length are
+  //! walked without recursion.
+  std::vector<Node *> line() const;
 
   //! Available print methods.
   void printPrefix() override;
   void printPython() override;
+  void printC() override;
+
+  //! Lowers the node to bytecode.
+  int lower(VM::Builder &) override;
 };
 
 class IfNode : public Node {
@@ -294,12 +529,15 @@ public:
   //! Basic constructor.
   IfNode(Node *, BlockNode *, BlockNode *);
 
-  //! Basic destructor.
-  ~IfNode() override;
+  static bool classof(const Node *n) { return n->kind == IF_NODE; }
 
   //! Available print methods.
   void printPrefix() override;
   void printPython() override;
+  void printC() override;
+
+  //! Lowers the node to bytecode.
+  int lower(VM::Builder &) override;
 
   //! Error handler logic; tests if the condition type is boolean.
   void error_handler() override;
@@ -325,12 +563,15 @@ public:
   //! Basic constructor.
   ForNode(Node *, Node *, Node *, BlockNode *);
 
-  //! Basic destructor.
-  ~ForNode() override;
+  static bool classof(const Node *n) { return n->kind == FOR_NODE; }
 
   //! Available print methods.
   void printPrefix() override;
   void printPython() override;
+  void printC() override;
+
+  //! Lowers the node to bytecode.
+  int lower(VM::Builder &) override;
 
   //! Error handler logic; tests if the condition type is boolean.
   void error_handler() override;
@@ -339,7 +580,7 @@ public:
 class FuncNode : public Node {
 public:
   //! Name of the function.
-  std::string id;
+  Name id;
 
   //! Pointer to the head node of the parameter list,
   //! producing a data structure similar to a linked list.
@@ -349,14 +590,20 @@ public:
   BlockNode *contents;
 
   //! Basic constructor.
-  FuncNode(std::string, Node *, int, BlockNode *);
+  FuncNode(Name id, Node *params, int type, BlockNode *contents)
+      : FuncNode(FUNC_NODE, id, params, type, contents) {}
 
-  //! Basic destructor.
-  ~FuncNode() override;
+  static bool classof(const Node *n) {
+    return n->kind >= FUNC_NODE && n->kind <= FILTER_FUNC_NODE;
+  }
 
   //! Available print methods.
   void printPrefix() override;
   void printPython() override;
+  void printC() override;
+
+  //! Lowers the node to bytecode.
+  int lower(VM::Builder &) override;
 
   //! Error handler logic; checks if the return type is correct.
   void error_handler() override;
@@ -368,12 +615,19 @@ public:
   //! Produces a double ended queue with all the nodes on the
   //! linked list of parameters.
   std::deque<VariableNode *> createDeque();
+
+protected:
+  //! Constructor used by subclasses to tag their concrete class.
+  FuncNode(NodeKind, Name, Node *, int, BlockNode *);
 };
 
 class ParamNode : public VariableNode {
 public:
   //! Basic constructor.
-  using VariableNode::VariableNode;
+  ParamNode(Name id, Node *next, int type, int size)
+      : VariableNode(PARAM_NODE, id, next, type, size) {}
+
+  static bool classof(const Node *n) { return n->kind == PARAM_NODE; }
 
   //! Available print methods.
   void printInfix() override;
@@ -383,10 +637,16 @@ public:
 class ReturnNode : public LinkedNode {
 public:
   //! Basic constructor.
-  ReturnNode(Node *next) : LinkedNode(next, next->_type()) {}
+  ReturnNode(Node *next) : LinkedNode(RETURN_NODE, next, next->_type()) {}
+
+  static bool classof(const Node *n) { return n->kind == RETURN_NODE; }
 
   //! Available print methods.
   void printPython() override;
+  void printC() override;
+
+  //! Lowers the node to bytecode.
+  int lower(VM::Builder &) override;
   void printPrefix() override;
 };
 
@@ -398,49 +658,62 @@ public:
   //! List of parameters used in the function call.
   BlockNode *params;
 
-  //! Basic constructor.
+  //! Basic constructor; the type is that of the original function.
   FuncCallNode(FuncNode *, BlockNode *);
 
-  //! Basic destructor.
-  ~FuncCallNode() override;
+  static bool classof(const Node *n) { return n->kind == FUNC_CALL_NODE; }
 
   //! Available print methods.
   void printPython() override;
+  void printC() override;
+
+  //! Lowers the node to bytecode.
+  int lower(VM::Builder &) override;
   void printPrefix() override;
 
   //! Error handler logic.
   void error_handler() override;
-
-  //! Returns the type of the original function.
-  NodeType _type() override;
 };
 
 class DeclarationNode : public VariableNode {
 public:
   //! Basic constructor.
-  using VariableNode::VariableNode;
+  DeclarationNode(Name id, Node *next, int type, int size)
+      : VariableNode(DECLARATION_NODE, id, next, type, size) {}
+
+  static bool classof(const Node *n) { return n->kind == DECLARATION_NODE; }
 
   //! Available print methods.
   void printInfix() override;
   void printPython() override;
+  void printC() override;
+
+  //! Lowers the node to bytecode.
+  int lower(VM::Builder &) override;
 };
 
 class HiOrdFuncNode : public FuncNode {
 public:
   //! Basic constructor.
-  HiOrdFuncNode(const std::string &, Node *, VariableNode *);
+  HiOrdFuncNode(NodeKind, Name, Node *, VarRefNode *);
+
+  static bool classof(const Node *n) {
+    return n->kind >= HI_ORD_FUNC_NODE && n->kind <= FILTER_FUNC_NODE;
+  }
 
   //! Special error handler that needs a certain node from the constructor.
   virtual void hi_error_handler(Node *);
 
   //! Returns the appropriate subclass given the id.
-  static HiOrdFuncNode *chooseFunc(const std::string &, Node *, VariableNode *);
+  static HiOrdFuncNode *chooseFunc(Name, Node *, VarRefNode *);
 };
 
 class MapFuncNode : public HiOrdFuncNode {
 public:
   //! Basic constructor.
-  MapFuncNode(const std::string &, Node *, VariableNode *);
+  MapFuncNode(Name, Node *, VarRefNode *);
+
+  static bool classof(const Node *n) { return n->kind == MAP_FUNC_NODE; }
 
   //! Error handler logic; checks number of parameters and lambda type.
   void hi_error_handler(Node *) override;
@@ -449,7 +722,9 @@ public:
 class FoldFuncNode : public HiOrdFuncNode {
 public:
   //! Basic constructor.
-  FoldFuncNode(const std::string &, Node *, VariableNode *);
+  FoldFuncNode(Name, Node *, VarRefNode *);
+
+  static bool classof(const Node *n) { return n->kind == FOLD_FUNC_NODE; }
 
   //! Error handler logic; checks number of parameters and lambda type.
   void hi_error_handler(Node *) override;
@@ -458,24 +733,76 @@ public:
 class FilterFuncNode : public HiOrdFuncNode {
 public:
   //! Basic constructor.
-  FilterFuncNode(const std::string &, Node *, VariableNode *);
+  FilterFuncNode(Name, Node *, VarRefNode *);
+
+  static bool classof(const Node *n) { return n->kind == FILTER_FUNC_NODE; }
 
   //! Error handler logic; checks number of parameters and lambda type.
   void hi_error_handler(Node *) override;
 };
 
-//! Pretty-prints an object with `cout`. Useful for tabulation.
+//! Checked downcast that compares the kind of the node instead of
+//! querying RTTI; returns null if the node is not a `T`.
+template <typename T> T *node_cast(Node *n) {
+  return (n != nullptr && T::classof(n)) ? static_cast<T *>(n) : nullptr;
+}
+
+//! Pretty-prints an object on the output sink. Useful for tabulation.
 /*!
  *  \param text     text to be printed.
  *  \param n        spaces to be added before the text.
  */
 template <typename T> void text(const T &text, int n) {
-  std::string blank(n, ' ');
-  std::cout << blank << text;
+  output->indent(n);
+  output->write(text);
+}
+
+//! Writes a whole program as C99 on the output sink. Every function is
+//! hoisted to the top level, receiving the addresses of the variables
+//! it reaches in the functions around it.
+/*!
+ *  \param root     outermost block of the program.
+ */
+void emitC(BlockNode *root);
+
+//! Folds the constant expressions of a program and simplifies it, in
+//! place: operations and casts on literals become literals, operations
+//! that leave an operand as it is are replaced by it, and branches whose
+//! condition is constant are dropped. Literals that some target would
+//! read differently, such as integers past 32 bits, are left unfolded.
+/*!
+ *  \param root     outermost block of a program without errors.
+ */
+void fold(BlockNode *root);
+
+//! Optional features of the Python code, which may be combined.
+enum PythonFeature {
+  //! Counted loops over `range`, appends with `list.append` and functors
+  //! over `map`, `filter` and `functools.reduce`.
+  python_idioms = 1,
+
+  //! Arrays of numbers and booleans held by `array.array`, unboxed, and
+  //! arrays of characters by strings unless an item is ever assigned.
+  python_arrays = 2
+};
+
+//! Writes a whole program as Python on the output sink, inside a `main`
+//! function. Variables are resolved beforehand: those of nested blocks
+//! are renamed apart, and functions declare the outer variables they
+//! assign as `nonlocal`.
+/*!
+ *  \param root     outermost block of the program.
+ *  \param features combination of `PythonFeature` values.
+ */
+void emitPython(BlockNode *root, int features);
+
+//! Pretty-prints a literal, straight from the buffer it was scanned from.
+inline void text(const View &text, int n) {
+  output->indent(n);
+  output->write(text.data, text.size);
 }
 
 } // namespace AST
 
-extern AST::BlockNode *string_read(const char *s);
 extern void yyerror(const char *s, ...);
 extern void yyserror(const char *s, ...);
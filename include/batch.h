@@ -0,0 +1,76 @@
+/*!
+ * Batch compilation of many source files for a language
+ * called Łukasiewicz, based on prefix notation.
+ *
+ *  \author Douglas Martins, Gustavo Zambonin, Marcello Klingelfus
+ */
+#pragma once
+
+#include "compiler.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//! Compiles a list of source files concurrently, one compilation per
+//! file. Results go either to one file each or, in the order of the
+//! list, to the standard output; diagnostics are tagged with the name
+//! of their file and written to the standard error in the same order.
+class Batch {
+public:
+  //! Source files to compile.
+  std::vector<std::string> files;
+
+  //! Number of threads compiling at once.
+  unsigned jobs = 1;
+
+  //! Language of the emitted code.
+  Target target = prefix_code;
+
+  //! Combination of `AST::PythonFeature` values used when emitting Python.
+  int python = 0;
+
+  //! Whether constants are folded before the code is emitted.
+  bool optimize = false;
+
+  //! Whether the lines of each program are written as soon as they are
+  //! parsed, which only prefix notation allows.
+  bool streaming = false;
+
+  //! Where the statistics of every compilation are added, or null to
+  //! keep none.
+  Stats *stats = nullptr;
+
+  //! Directory where each result is written, or null to write every
+  //! result to the standard output.
+  const char *outdir = nullptr;
+
+  //! Appends the files listed on a manifest, one path per line.
+  /*!
+   *  \param path     name of the manifest.
+   */
+  bool manifest(const char *path);
+
+  //! Compiles every file and reports the throughput on the standard
+  //! error. Returns the number of files that could not be compiled.
+  int run();
+
+private:
+  //! Outcome of a single compilation, kept until it is written.
+  struct Result {
+    std::string code;
+    std::string diagnostics;
+    std::size_t lines = 0;
+    Stats stats;
+    bool failed = false;
+    bool done = false;
+  };
+
+  //! One result per file.
+  std::vector<Result> results;
+
+  //! Compiles the `i`-th file into its result.
+  void compile(std::size_t i);
+
+  //! Name of the file where the result of `path` is written.
+  std::string destination(const std::string &path) const;
+};
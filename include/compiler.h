@@ -0,0 +1,191 @@
+/*!
+ * Compilation context for a language called
+ * Łukasiewicz, based on prefix notation.
+ *
+ *  \author Douglas Martins, Gustavo Zambonin, Marcello Klingelfus
+ */
+#pragma once
+
+#include "ast.h"
+#include "st.h"
+#include "stats.h"
+#include <cstdio>
+#include <vector>
+
+//! Opaque state of a reentrant scanner, as defined by flex.
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+
+//! Languages the syntax tree can be written in; `pyc_code` is the
+//! Python translation compiled ahead of time into a `.pyc` file.
+enum Target { prefix_code, python_code, c_code, pyc_code };
+
+//! Everything a single compilation needs, so that independent
+//! compilations may run concurrently on different threads. While a
+//! compilation is parsing or emitting code, it is bound to the thread
+//! through `compiler`, `arena`, `names` and `output`.
+class Compiler {
+public:
+  //! Symbol table holding every open scope.
+  ST::SymbolTable table;
+
+  //! Root of the abstract syntax tree.
+  AST::BlockNode *root = nullptr;
+
+  //! Temporary variable used to simplify the grammar on declarations.
+  int tmp_t = 0;
+
+  //! Temporary variable used to insert the functor node inside the program.
+  AST::Node *tmp_f = nullptr;
+
+  //! Region that owns every node of the abstract syntax tree.
+  AST::Arena arena;
+
+  //! Identifiers and literals seen by the scanner.
+  AST::Interner names;
+
+  //! Sink where the emitted code is written.
+  AST::Writer &output;
+
+  //! Stream where diagnostics are written.
+  FILE *diagnostics = stderr;
+
+  //! Name of the source file, which prefixes every diagnostic if set.
+  const char *source = nullptr;
+
+  //! State of the reentrant scanner.
+  yyscan_t scanner;
+
+  //! Number of lexical, syntax and semantic errors reported so far.
+  int errors = 0;
+
+  //! Combination of `AST::PythonFeature` values used when emitting Python.
+  int python = 0;
+
+  //! Folds constants and simplifies the syntax tree before it is written
+  //! or run, unless the program has errors.
+  bool optimize = false;
+
+  //! Writes each line of the outermost block in prefix notation as soon
+  //! as it is parsed, and then drops its nodes unless it defined symbols
+  //! that later lines may refer to; `root` is left empty.
+  bool streaming = false;
+
+  //! Where the time of each phase and the counters of the work done are
+  //! added, or null to keep no statistics; the last of them are gathered
+  //! when the compilation is destroyed.
+  Stats *stats = nullptr;
+
+  //! Basic constructor.
+  /*!
+   *  \param output   sink where the emitted code is written.
+   */
+  explicit Compiler(AST::Writer &output);
+
+  //! Basic destructor; releases the syntax tree and the scanner.
+  ~Compiler();
+
+  Compiler(const Compiler &) = delete;
+  Compiler &operator=(const Compiler &) = delete;
+
+  //! Builds the syntax tree of a whole program. A regular file is mapped
+  //! into memory and scanned in place; any other stream is read whole
+  //! into a single buffer first.
+  /*!
+   *  \param in       stream holding the source code.
+   */
+  void parse(FILE *in);
+
+  //! Writes the syntax tree to the output sink.
+  /*!
+   *  \param target   language of the emitted code.
+   */
+  void emit(Target target);
+
+  //! Writes the lines just added to the outermost block, if streaming,
+  //! and then takes them off it. Called by the parser on every block.
+  /*!
+   *  \param lines    block whose last line was just parsed.
+   */
+  void stream(AST::BlockNode *lines);
+
+  //! Runs the program on the bytecode machine instead of emitting code.
+  //! Returns false if the program has errors or fails while running.
+  /*!
+   *  \param trace    lists the bytecode and dumps the globals at the end.
+   */
+  bool execute(bool trace);
+
+  //! Number of the line being read by the scanner.
+  int line();
+
+private:
+  //! Source buffer, which literals keep viewing until the compilation
+  //! is destroyed.
+  struct Input {
+    char *base;
+    std::size_t length;
+    bool mapped;
+  };
+
+  //! Every buffer parsed by this compilation.
+  std::vector<Input> inputs;
+
+  //! Point of the arena past the lines kept while streaming, if any.
+  AST::Arena::Mark kept = {0, 0, 0, nullptr, nullptr};
+  bool marked = false;
+
+  //! Definitions on the outermost scope when `kept` was taken.
+  std::size_t globals = 0;
+
+  //! Functions declared ahead on lines not yet streamed, and lines of
+  //! the outermost block already searched for them.
+  std::vector<AST::FuncNode *> declared;
+  std::size_t checked = 0;
+
+  //! Loads a whole stream into a buffer ending with two null bytes.
+  /*!
+   *  \param in       stream holding the source code.
+   *  \param size     where the length of the source is stored.
+   */
+  Input load(FILE *in, std::size_t &size);
+
+  //! Writes the syntax tree as a compiled Python module, reporting on
+  //! the diagnostics if the embedded interpreter cannot produce it.
+  void emitPyc();
+
+  //! Binds a compilation to the current thread for its lifetime.
+  class Bind {
+  public:
+    explicit Bind(Compiler *bound);
+    ~Bind();
+
+  private:
+    //! Bindings in place before this one.
+    Compiler *c;
+    AST::Arena *a;
+    AST::Interner *i;
+    AST::Writer *o;
+  };
+};
+
+//! Compilation bound to the current thread.
+extern thread_local Compiler *compiler;
+
+/* Reentrant scanner interface, as generated by flex. */
+int yylex_init_extra(Compiler *extra, yyscan_t *scanner);
+int yylex_destroy(yyscan_t scanner);
+int yyget_lineno(yyscan_t scanner);
+
+//! Scans a buffer in place; its last two bytes must be null.
+void scan_buffer(char *base, std::size_t size, yyscan_t scanner);
+
+//! Truncates a single-quoted word to its first character, warning about
+//! it; shared by both scanners.
+/*!
+ *  \param s        text of the literal, quotes included.
+ *  \param n        length of the text.
+ */
+AST::View reduce_char(const char *s, int n);
@@ -0,0 +1,99 @@
+/*!
+ * Flat representation of the abstract syntax tree of a language
+ * called Łukasiewicz, based on prefix notation.
+ *
+ *  \author Douglas Martins, Gustavo Zambonin, Marcello Klingelfus
+ */
+#pragma once
+
+#include "ast.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace AST {
+
+//! Syntax tree lowered into a table of parallel arrays, one entry per
+//! node, for passes that would rather sweep memory in order than chase
+//! pointers. Nodes are numbered breadth first from the root, so that
+//! the children of a node are contiguous, every parent comes before its
+//! children, and the children of consecutive nodes are consecutive too:
+//! those of node `i` are the nodes from `first[i]` up to `first[i + 1]`.
+//! Literals and names are kept once each on a shared pool of text.
+//!
+//! Children of each kind of node, in order:
+//!   - binary operations: left and right operands;
+//!   - unary operations: their operand;
+//!   - blocks: statements and hoisted functors, in the order of the source;
+//!   - `if`: condition, `then` block and `else` block;
+//!   - `for`: assignment, test, iteration and body;
+//!   - function calls: their arguments;
+//!   - lines of declarations: each declaration, first to last;
+//!   - returns: the value returned;
+//!   - functions: their parameters, and then their body, if any.
+//!
+//! A missing child, such as the assignment of a `for` left empty or a
+//! part of a line with errors, is a node of kind `BASE_NODE`.
+//!
+//! The table is built from the tree once it is parsed, and is not
+//! updated if the tree changes afterwards.
+class Flat {
+public:
+  //! Position of a node on the table.
+  typedef std::uint32_t Index;
+
+  //! Position of no node, referenced by uses of variables or functions
+  //! declared outside of the table.
+  static const Index none = 0xffffffff;
+
+  //! Concrete class of each node, as a `NodeKind`.
+  std::vector<std::uint8_t> kinds;
+
+  //! Type of each node, as a `NodeType`.
+  std::vector<std::int8_t> types;
+
+  //! Operation of each unary or binary operation, as an `Operation`, and
+  //! zero for any other node.
+  std::vector<std::uint8_t> ops;
+
+  //! Position of the first child of each node, followed by the number of
+  //! nodes on the table.
+  std::vector<Index> first;
+
+  //! Value of each node: the value of integer and boolean literals, the
+  //! position on the pool of the text of other literals and of the name
+  //! of variables and functions, and the position on the table of the
+  //! declaration used by a variable or of the function called.
+  std::vector<std::uint32_t> values;
+
+  //! Length of each array declared, and zero for any other node.
+  std::vector<std::uint32_t> sizes;
+
+  //! Texts of literals and names, each followed by a null byte.
+  std::string pool;
+
+  //! Builds the table of a tree, without recursion.
+  /*!
+   *  \param root     outermost block of the program.
+   */
+  explicit Flat(BlockNode *root);
+
+  //! Number of nodes on the table.
+  Index size() const { return static_cast<Index>(kinds.size()); }
+
+  //! Bounds of the children of a node.
+  Index begin(Index i) const { return first[i]; }
+  Index end(Index i) const { return first[i + 1]; }
+
+  //! Text on the pool that the value of a node refers to.
+  /*!
+   *  \param i        position of a literal, variable or function.
+   */
+  const char *text(Index i) const { return pool.data() + values[i]; }
+
+  //! Bytes taken by the table.
+  std::size_t bytes() const;
+};
+
+} // namespace AST
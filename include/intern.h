@@ -0,0 +1,74 @@
+/*!
+ * Interned identifiers and literals for a language
+ * called Łukasiewicz, based on prefix notation.
+ *
+ *  \author Douglas Martins, Gustavo Zambonin, Marcello Klingelfus
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace AST {
+
+//! Handle to an interned string. Two handles are equal if and only if
+//! their strings are equal, so names are compared by pointer.
+typedef const std::string *Name;
+
+//! Text of a literal, viewing the buffer it was scanned from instead of
+//! owning a copy. Buffers live as long as their compilation.
+struct View {
+  const char *data;
+  std::size_t size;
+
+  //! Copies the text to a string.
+  std::string str() const { return std::string(data, size); }
+};
+
+//! Open-addressing table that stores every distinct string exactly once.
+class Interner {
+public:
+  //! Basic constructor.
+  Interner() : slots(256) {}
+
+  //! Returns the unique handle for a sequence of characters, storing
+  //! it in the table if it was not seen before.
+  /*!
+   *  \param s        first character of the sequence.
+   *  \param n        length of the sequence.
+   */
+  Name intern(const char *s, std::size_t n);
+
+  //! Number of distinct strings stored.
+  std::size_t size() const { return strings.size(); }
+
+private:
+  //! Slot of the hash table; an empty slot has a null `name`.
+  struct Slot {
+    std::uint32_t hash;
+    Name name;
+  };
+
+  //! Hash table, whose size is always a power of two.
+  std::vector<Slot> slots;
+
+  //! Storage for the strings; a deque never moves its elements.
+  std::deque<std::string> strings;
+
+  //! Doubles the size of the table, reinserting every slot.
+  void grow();
+};
+
+//! Returns the unique handle for a string, using the table of the
+//! compilation bound to the current thread.
+Name intern(const char *s, std::size_t n);
+Name intern(const char *s);
+Name intern(const std::string &s);
+
+} // namespace AST
+
+//! Table of the compilation bound to the current thread.
+extern thread_local AST::Interner *names;
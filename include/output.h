@@ -0,0 +1,80 @@
+/*!
+ * Buffered output for the code emitters of a language
+ * called Łukasiewicz, based on prefix notation.
+ *
+ *  \author Douglas Martins, Gustavo Zambonin, Marcello Klingelfus
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace AST {
+
+//! Output sink that gathers emitted text in a large buffer and hands it
+//! to a file descriptor or an in-memory string in bulk.
+class Writer {
+public:
+  //! Writes to a file descriptor, such as `STDOUT_FILENO`.
+  explicit Writer(int fd) : fd(fd) {}
+
+  //! Appends to a string.
+  explicit Writer(std::string *str) : str(str) {}
+
+  //! Basic destructor; flushes whatever is still buffered.
+  ~Writer() { flush(); }
+
+  Writer(const Writer &) = delete;
+  Writer &operator=(const Writer &) = delete;
+
+  //! Appends a sequence of characters.
+  /*!
+   *  \param s        first character of the sequence.
+   *  \param n        length of the sequence.
+   */
+  void write(const char *s, std::size_t n) {
+    if (n > sizeof(buffer) - used) {
+      flush();
+      if (n > sizeof(buffer)) {
+        sink(s, n);
+        return;
+      }
+    }
+    std::memcpy(buffer + used, s, n);
+    used += n;
+  }
+
+  //! Appends text of several kinds.
+  void write(const char *s) { write(s, std::strlen(s)); }
+  void write(const std::string &s) { write(s.data(), s.size()); }
+  void write(int v);
+
+  //! Appends `n` blanks, copied from a precomputed run of spaces.
+  void indent(int n);
+
+  //! Hands the buffered text to the destination.
+  void flush();
+
+  //! Current indentation of the emitted code.
+  int spaces = 0;
+
+private:
+  //! Destination file descriptor, if `str` is null.
+  int fd = -1;
+
+  //! Destination string, if any.
+  std::string *str = nullptr;
+
+  //! Pending text and its length.
+  char buffer[1 << 16];
+  std::size_t used = 0;
+
+  //! Writes a sequence of characters straight to the destination.
+  void sink(const char *s, std::size_t n);
+};
+
+} // namespace AST
+
+//! Sink of the compilation bound to the current thread.
+extern thread_local AST::Writer *output;
@@ -0,0 +1,54 @@
+/*!
+ * Work-stealing thread pool for the batch mode of a compiler
+ * for a language called Łukasiewicz, based on prefix notation.
+ *
+ *  \author Douglas Martins, Gustavo Zambonin, Marcello Klingelfus
+ */
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+//! Fixed set of workers that run numbered tasks. Each worker owns a
+//! contiguous range of tasks and takes them from the front; a worker
+//! whose queue is empty steals from the back of the others, so that a
+//! few long tasks do not leave the remaining workers idle.
+class Pool {
+public:
+  //! Basic constructor.
+  /*!
+   *  \param workers  number of threads; at least one is used.
+   */
+  explicit Pool(unsigned workers);
+
+  //! Runs `task(i)` for every `i` in `[0, tasks)`, returning once all of
+  //! them are finished.
+  /*!
+   *  \param tasks    number of tasks.
+   *  \param task     function called with the index of each task.
+   */
+  void run(std::size_t tasks, const std::function<void(std::size_t)> &task);
+
+private:
+  //! Tasks waiting to run on a single worker.
+  struct Queue {
+    std::mutex lock;
+    std::deque<std::size_t> tasks;
+  };
+
+  //! One queue per worker.
+  std::vector<Queue> queues;
+
+  //! Takes the next task of worker `w`, stealing if needed.
+  /*!
+   *  \param w        index of the worker.
+   *  \param task     where the index of the task is stored.
+   */
+  bool next(std::size_t w, std::size_t &task);
+
+  //! Main loop of worker `w`.
+  void work(std::size_t w, const std::function<void(std::size_t)> &task);
+};
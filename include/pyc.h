@@ -0,0 +1,31 @@
+/*!
+ * Compiled Python modules for a language called
+ * Łukasiewicz, based on prefix notation.
+ *
+ *  \author Douglas Martins, Gustavo Zambonin, Marcello Klingelfus
+ */
+#pragma once
+
+#include <string>
+
+namespace PYC {
+
+//! Whether the compiler was built with an embedded CPython, the only
+//! one that can produce code objects its own version will load; the
+//! build must set `LUKA_PYC` and link against `libpython`.
+bool available();
+
+//! Compiles Python source into the contents of a `.pyc` file: the magic
+//! number of the embedded interpreter, a header that skips the check of
+//! the source, and the marshalled code object of the module. Returns
+//! false, leaving the reason on `error`, if the source does not compile.
+/*!
+ *  \param source   text of the module.
+ *  \param filename name that tracebacks of the module will show.
+ *  \param pyc      where the contents are appended.
+ *  \param error    where the reason of a failure is stored.
+ */
+bool compile(const std::string &source, const char *filename,
+             std::string &pyc, std::string &error);
+
+} // namespace PYC
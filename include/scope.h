@@ -0,0 +1,122 @@
+/*!
+ * Scoped symbol storage for a language called
+ * Łukasiewicz, based on prefix notation.
+ *
+ *  \author Douglas Martins, Gustavo Zambonin, Marcello Klingelfus
+ */
+#pragma once
+
+#include "intern.h"
+#include <cstdint>
+#include <vector>
+
+namespace ST {
+
+//! Type of symbol stored in the symbol table,
+//! such as variables and functions.
+enum SymbolType { variable, function };
+
+//! Single open-addressing hash table keyed by an interned name and its
+//! kind, where each entry is the head of a stack of bindings, one per
+//! scope that declares the name. Opening a scope records a marker and
+//! closing it pops every binding made since, so a lookup never walks
+//! the chain of enclosing scopes.
+class Scopes {
+public:
+  //! Basic constructor.
+  Scopes() : slots(64) {}
+
+  //! Starts a new innermost scope.
+  void open() {
+    marks.push_back(bindings.size());
+    deepest = (marks.size() > deepest) ? marks.size() : deepest;
+  }
+
+  //! Discards the innermost scope along with all of its bindings.
+  void close();
+
+  //! Number of scopes currently open.
+  std::size_t depth() const { return marks.size(); }
+
+  //! Most scopes that were open at once.
+  std::size_t maxDepth() const { return deepest; }
+
+  //! Binds a symbol to a name on the innermost scope.
+  /*!
+   *  \param type     discerns between variable and function.
+   *  \param key      interned identifier of the symbol.
+   *  \param symbol   opaque pointer to the symbol.
+   */
+  void bind(SymbolType type, AST::Name key, void *symbol);
+
+  //! Removes the binding of a name on the innermost scope, if any.
+  /*!
+   *  \param type     discerns between variable and function.
+   *  \param key      interned identifier of the symbol.
+   */
+  void unbind(SymbolType type, AST::Name key);
+
+  //! Returns the innermost symbol bound to a name, or null.
+  /*!
+   *  \param type     discerns between variable and function.
+   *  \param key      interned identifier of the symbol.
+   */
+  void *find(SymbolType type, AST::Name key) const;
+
+  //! Returns the symbol bound to a name on the innermost scope, or null.
+  /*!
+   *  \param type     discerns between variable and function.
+   *  \param key      interned identifier of the symbol.
+   */
+  void *findHere(SymbolType type, AST::Name key) const;
+
+  //! Returns the number of scopes between the innermost one and the
+  //! one that binds a name, or 0 if the name is unbound.
+  /*!
+   *  \param type     discerns between variable and function.
+   *  \param key      interned identifier of the symbol.
+   */
+  std::size_t distance(SymbolType type, AST::Name key) const;
+
+private:
+  //! Slot of the hash table; an empty slot has a null `key`.
+  struct Slot {
+    AST::Name key = nullptr;
+    SymbolType type = variable;
+    //! Index of the innermost binding, or -1 if the name is unbound.
+    std::int32_t head = -1;
+  };
+
+  //! A name bound on some scope, shadowing the binding at `prev`.
+  struct Binding {
+    std::uint32_t slot;
+    std::int32_t prev;
+    void *symbol;
+  };
+
+  //! Hash table, whose size is always a power of two.
+  std::vector<Slot> slots;
+
+  //! Number of used slots.
+  std::size_t used = 0;
+
+  //! Every live binding, innermost scope last.
+  std::vector<Binding> bindings;
+
+  //! Size of `bindings` when each open scope started.
+  std::vector<std::size_t> marks;
+
+  //! Most scopes open at once.
+  std::size_t deepest = 0;
+
+  //! Index of the first binding made on the innermost scope.
+  std::size_t innermost() const { return marks.empty() ? 0 : marks.back(); }
+
+  //! Returns the slot of a key, or the empty slot where it belongs.
+  std::size_t probe(SymbolType type, AST::Name key) const;
+
+  //! Doubles the size of the table, reinserting every slot.
+  void grow();
+};
+
+} // namespace ST
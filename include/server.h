@@ -0,0 +1,100 @@
+/*!
+ * Resident compile server for a language called
+ * Łukasiewicz, based on prefix notation.
+ *
+ *  \author Douglas Martins, Gustavo Zambonin, Marcello Klingelfus
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//! Flags of a request, matching the command line options.
+enum RequestFlag {
+  python_flag = 1,
+  debug_flag = 2,
+  c_flag = 4,
+  idioms_flag = 8,
+  arrays_flag = 16,
+  pyc_flag = 32,
+  optimize_flag = 64
+};
+
+//! Compiler that stays resident, listening on a Unix domain socket.
+//!
+//! A client may send any number of requests on a connection, each made
+//! of a header with two 32-bit words, the flags and the length of the
+//! source, followed by the source itself. Every request is answered by
+//! a header with the lengths of the emitted code and of the diagnostics,
+//! followed by both texts. Connections are served concurrently, each on
+//! its own thread.
+class Server {
+public:
+  //! Binds the socket, replacing any stale file at `path`.
+  /*!
+   *  \param path     name of the socket on the file system.
+   */
+  explicit Server(const char *path);
+
+  //! Basic destructor; closes and removes the socket.
+  ~Server();
+
+  Server(const Server &) = delete;
+  Server &operator=(const Server &) = delete;
+
+  //! Checks if the socket is ready to accept connections.
+  bool ready() const { return fd >= 0; }
+
+  //! Accepts connections until the process is stopped.
+  void serve();
+
+private:
+  //! Name of the socket.
+  std::string path;
+
+  //! Listening socket.
+  int fd = -1;
+
+  //! Answers every request of a connection, closing it at the end.
+  static void answer(int conn);
+};
+
+//! Connection to a resident server.
+class Client {
+public:
+  //! Connects to the socket at `path`.
+  explicit Client(const char *path);
+
+  //! Basic destructor; closes the connection.
+  ~Client();
+
+  Client(const Client &) = delete;
+  Client &operator=(const Client &) = delete;
+
+  //! Checks if the connection was established.
+  bool ready() const { return fd >= 0; }
+
+  //! Compiles a program on the server.
+  /*!
+   *  \param source       source code of the program.
+   *  \param flags        combination of `RequestFlag` values.
+   *  \param code         where the emitted code is stored.
+   *  \param diagnostics  where the diagnostics are stored.
+   */
+  bool compile(const std::string &source, std::uint32_t flags,
+               std::string &code, std::string &diagnostics);
+
+  //! Compiles every file on the server, or the standard input if there
+  //! are none, writing the results in order as the command line does.
+  //! Returns the number of files that could not be compiled.
+  /*!
+   *  \param files        names of the source files.
+   *  \param flags        combination of `RequestFlag` values.
+   */
+  int run(const std::vector<std::string> &files, std::uint32_t flags);
+
+private:
+  //! Connected socket.
+  int fd = -1;
+};
@@ -7,49 +7,55 @@
 #pragma once
 
 #include "ast.h"
-#include <map>
+#include "scope.h"
 
 namespace ST {
 
-//! Type of symbol stored in the symbol table,
-//! such as variables and functions.
-enum SymbolType { variable, function };
-
 //! Class that represents, essentially, a hashed map between
-//! identifiers and their `Symbol` representation.
+//! identifiers and their `Symbol` representation, for every scope
+//! that is currently open.
 class SymbolTable {
 public:
-  //! List of entries within this table.
-  std::map<SymbolType, std::map<std::string, AST::Node *>> entryList;
+  //! Bindings of every open scope.
+  Scopes scopes;
+
+  //! Number of variables and functions defined on the outermost scope,
+  //! which tells whether a line of the program left nodes on the table.
+  std::size_t globals = 0;
 
-  //! Parent table used to represent possible external scopes on the
-  //! program, thereby creating a linked structure between the symbol tables.
-  SymbolTable *external;
+  //! Starts a new scope nested in the current one.
+  void openScope() { scopes.open(); }
 
-  //! Basic constructor.
-  explicit SymbolTable(SymbolTable *external) : external(external) {}
+  //! Discards the current scope, returning to its parent.
+  void closeScope() { scopes.close(); }
 
-  //! Inserts a symbol on this table.
+  //! Inserts a symbol on the current scope.
   /*!
    *  \param type     discerns between variable and function.
-   *  \param key      string identifier of the symbol.
+   *  \param key      interned identifier of the symbol.
    *  \param symbol   Node object.
    */
-  void addSymbol(SymbolType type, const std::string &key, AST::Node *symbol);
+  void addSymbol(SymbolType type, AST::Name key, AST::Node *symbol);
 
-  //! Checks if an identifier is present on this symbol table.
+  //! Checks if an identifier is present on the current scope.
   /*!
    *  \param type     discerns between variable and function.
-   *  \param key      string identifier of the symbol.
+   *  \param key      interned identifier of the symbol.
    */
-  bool symbolExistsHere(SymbolType type, const std::string &key);
+  bool symbolExistsHere(SymbolType type, AST::Name key);
 
-  //! Returns a variable node inside of a certain symbol.
+  //! Removes an identifier from the current scope.
+  /*!
+   *  \param type     discerns between variable and function.
+   *  \param key      interned identifier of the symbol.
+   */
+  void removeSymbol(SymbolType type, AST::Name key);
+
+  //! Returns a reference to the variable declared under a certain symbol.
   /*!
    *  \param key      identifier of the symbol.
    */
-  AST::VariableNode *getVarFromTable(char *key);
-  AST::VariableNode *getVarFromTable(const std::string &key);
+  AST::VarRefNode *getVarFromTable(AST::Name key);
 
   //! Creates a new node with informations from the table and tokens
   //! from the grammar.
@@ -61,17 +67,14 @@ public:
    *  \param size     size of the array if applicable.
    *  \param isParam  returns a `ParamNode` if applicable.
    */
-  AST::Node *newVariable(char *key, AST::Node *next, int type, int size,
+  AST::Node *newVariable(AST::Name key, AST::Node *next, int type, int size,
                          bool isParam = false);
-  AST::Node *newVariable(const std::string &key, AST::Node *next, int type,
-                         int size, bool isParam = false);
 
   //! Returns a function node inside of a certain symbol.
   /*!
    *  \param key      identifier of the symbol.
    */
-  AST::FuncNode *getFuncFromTable(char *key);
-  AST::FuncNode *getFuncFromTable(const std::string &key);
+  AST::FuncNode *getFuncFromTable(AST::Name key);
 
   //! Creates a new node representing a function, with informations
   //! from the grammar.
@@ -81,9 +84,7 @@ public:
    *  \param type     return type of the function.
    *  \param contents body of the function.
    */
-  AST::Node *newFunction(char *key, AST::Node *params, int type,
-                         AST::BlockNode *contents);
-  AST::Node *newFunction(std::string key, AST::Node *params, int type,
+  AST::Node *newFunction(AST::Name key, AST::Node *params, int type,
                          AST::BlockNode *contents);
 };
 
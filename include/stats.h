@@ -0,0 +1,104 @@
+/*!
+ * Compilation statistics for a language called
+ * Łukasiewicz, based on prefix notation.
+ *
+ *  \author Douglas Martins, Gustavo Zambonin, Marcello Klingelfus
+ */
+#pragma once
+
+#include "arena.h"
+#include "ast.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+//! Wall time spent on each phase of a compilation and counters of the
+//! work done, gathered only when a compilation is handed one, and
+//! reported as text or as JSON.
+class Stats {
+public:
+  //! Phases of a compilation. Lexing and checking happen while the
+  //! parser runs, and are not counted as parsing.
+  enum Phase { lexing, parsing, checking, emission, teardown, phases };
+
+  //! Measures the wall time of a phase for as long as it lives, and
+  //! does nothing if there are no statistics to keep.
+  class Timer {
+  public:
+    //! Starts measuring.
+    /*!
+     *  \param stats    where the time is added, or null.
+     *  \param phase    phase being measured.
+     */
+    Timer(Stats *stats, Phase phase) : stats(stats), phase(phase) {
+      if (stats != nullptr) {
+        start = std::chrono::steady_clock::now();
+      }
+    }
+
+    //! Adds the time elapsed since the start to the phase.
+    ~Timer() {
+      if (stats != nullptr) {
+        stats->seconds[phase] +=
+            std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                          start)
+                .count();
+      }
+    }
+
+    Timer(const Timer &) = delete;
+    Timer &operator=(const Timer &) = delete;
+
+  private:
+    Stats *stats;
+    Phase phase;
+    std::chrono::steady_clock::time_point start;
+  };
+
+  //! Seconds spent on each phase.
+  double seconds[phases] = {};
+
+  //! Number of tokens read by the parser.
+  std::size_t tokens = 0;
+
+  //! Number of nodes of each concrete class.
+  std::size_t nodes[AST::FILTER_FUNC_NODE + 1] = {};
+
+  //! Lookups of variables and of functions on the symbol table.
+  std::size_t variables = 0, functions = 0;
+
+  //! Scopes between the innermost one and the one that bound each name
+  //! found on the symbol table, which a lookup skips at no extra cost.
+  std::size_t hops = 0;
+
+  //! Most scopes open at once.
+  std::size_t depth = 0;
+
+  //! Bytes of source, and bytes handed out by the arena.
+  std::size_t source = 0, arena = 0;
+
+  //! Number of distinct identifiers and literals interned.
+  std::size_t names = 0;
+
+  //! Counts the nodes of an arena and the bytes it handed out since a
+  //! point, by default since it was created; must be called before the
+  //! arena is released or rewound to that point.
+  /*!
+   *  \param a        arena of the compilation.
+   *  \param since    point of the arena from which to count.
+   */
+  void gather(const AST::Arena &a, const AST::Arena::Mark &since = {});
+
+  //! Adds the statistics of another compilation to these.
+  /*!
+   *  \param other    statistics to add.
+   */
+  void add(const Stats &other);
+
+  //! Writes every statistic.
+  /*!
+   *  \param out      stream where the report is written.
+   *  \param json     writes a single JSON object instead of a table.
+   */
+  void report(FILE *out, bool json) const;
+};
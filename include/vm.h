@@ -0,0 +1,319 @@
+/*!
+ * Bytecode and virtual machine for a language called
+ * Łukasiewicz, based on prefix notation.
+ *
+ *  \author Douglas Martins, Gustavo Zambonin, Marcello Klingelfus
+ */
+#pragma once
+
+#include "ast.h"
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace VM {
+
+//! Every operation of the machine, in the order of their opcodes. The
+//! operands `a`, `b` and `c` name registers of the current frame unless
+//! noted otherwise, `a` being where the result goes; `k` is the wide
+//! operand formed by `b` and `c`, and `x` a small count.
+#define VM_OPERATIONS(X)                                                       \
+  X(MOVE)    /* a = b */                                                       \
+  X(LOADI)   /* a = k */                                                       \
+  X(LOADK)   /* a = constant b */                                              \
+  X(LOADS)   /* a = new array holding string constant b */                     \
+  X(LOADUP)  /* a = register b of the frame x static links up */               \
+  X(STOREUP) /* register b of the frame x static links up = a */               \
+  X(ADDRUP)  /* a = address of register b of the frame x links up */           \
+  X(ADDR)    /* a = address of register b */                                   \
+  X(ADDRIDX) /* a = address of b[c] */                                         \
+  X(LOAD)    /* a = value pointed by b */                                      \
+  X(STORE)   /* value pointed by a = b */                                      \
+  X(NEWARR)  /* a = new array of k zeros */                                    \
+  X(INDEX)   /* a = b[c] */                                                    \
+  X(SETIDX)  /* a[b] = c */                                                    \
+  X(APPEND)  /* appends b to the array a */                                    \
+  X(LEN)     /* a = length of the array b */                                   \
+  X(CONCAT)  /* a = new array joining b and c */                               \
+  X(CMPARR)  /* a = -1, 0 or 1 ordering b and c, of floats if x */             \
+  X(ADDI) X(SUBI) X(MULI) X(DIVI) X(NEGI)                                      \
+  X(ADDF) X(SUBF) X(MULF) X(DIVF) X(NEGF)                                      \
+  X(EQI) X(NEI) X(LTI) X(LEI) X(GTI) X(GEI)                                    \
+  X(EQF) X(NEF) X(LTF) X(LEF) X(GTF) X(GEF)                                    \
+  X(AND) X(OR) X(NOT)                                                          \
+  X(ITOF) X(FTOI) X(ITOB) X(FTOB) X(CTOS) X(ITOS)                              \
+  X(JUMP)    /* continues at k */                                              \
+  X(JUMPF)   /* continues at k if a is false */                                \
+  X(JUMPT)   /* continues at k if a is true */                                 \
+  X(CALL)    /* calls function b with the arguments from register a on,     \
+                leaving the result on a; the static link is x links up */    \
+  X(RET)     /* returns a */                                                   \
+  X(HALT)
+
+//! Opcodes.
+enum Op : std::uint8_t {
+#define VM_ENUM(name) name,
+  VM_OPERATIONS(VM_ENUM)
+#undef VM_ENUM
+};
+
+//! Instruction of eight bytes. Jumps and immediates read `b` and `c`
+//! together as a single wide operand.
+struct Instr {
+  std::uint8_t op;
+  std::uint8_t x;
+  std::uint16_t a;
+  std::uint16_t b;
+  std::uint16_t c;
+
+  //! Wide operand stored on `b` and `c`.
+  std::int32_t k() const {
+    return static_cast<std::int32_t>((std::uint32_t(b) << 16) | c);
+  }
+};
+
+struct Array;
+
+//! Untagged value; the static type of each register tells which member
+//! is in use. Booleans and characters are stored as integers.
+union Value {
+  std::int64_t i;
+  double f;
+  Value *p;
+  Array *a;
+};
+
+//! Array whose length may grow by appending; strings are arrays of
+//! characters. Arrays are shared by reference, as in Python.
+struct Array {
+  std::vector<Value> items;
+};
+
+//! Compiled function. Register 0 of its frames holds the static link,
+//! the frame of the enclosing function, and the parameters follow.
+struct Function {
+  //! Name of the function, empty for the program itself.
+  std::string name;
+
+  //! Instructions of the body.
+  std::vector<Instr> code;
+
+  //! Number of parameters.
+  int params = 0;
+
+  //! Number of registers of each frame.
+  int frame = 1;
+
+  //! Enclosing function, or -1 for the program itself.
+  int parent = -1;
+};
+
+//! Variable declared on the outermost block of a program.
+struct Global {
+  AST::Name name;
+  AST::NodeType type;
+  int reg;
+};
+
+//! Whole program, whose first function is the outermost block.
+struct Program {
+  //! Every function, called by its index.
+  std::vector<Function> functions;
+
+  //! Numeric constants that do not fit an immediate.
+  std::vector<Value> constants;
+
+  //! String constants.
+  std::vector<std::string> strings;
+
+  //! Variables of the outermost block, which can be inspected after a run.
+  std::vector<Global> globals;
+
+  //! Writes a listing of every function.
+  /*!
+   *  \param out      stream where the listing is written.
+   */
+  void disassemble(FILE *out) const;
+};
+
+//! Lowers a syntax tree to a program. Nodes lower themselves through
+//! `AST::Node::lower`, asking the builder for registers and emitting
+//! instructions on the function being built. Functions are built one at
+//! a time: a definition is queued when it is met, and its body is built
+//! once the function around it is done, when every variable it may
+//! reach already has a register.
+class Builder {
+public:
+  //! Basic constructor.
+  /*!
+   *  \param program      where the lowered functions are stored.
+   *  \param diagnostics  stream where errors are reported.
+   */
+  Builder(Program &program, FILE *diagnostics)
+      : program(program), diagnostics(diagnostics) {}
+
+  //! Lowers a whole program. Returns the number of constructs that the
+  //! machine cannot run, each reported on the diagnostics.
+  /*!
+   *  \param root     outermost block of the program.
+   */
+  int build(AST::BlockNode *root);
+
+  //! Appends an instruction to the current function, returning its index.
+  int emit(Op op, int a = 0, int b = 0, int c = 0, int x = 0);
+
+  //! Appends an instruction with a wide operand.
+  int emitk(Op op, int a, std::int32_t k);
+
+  //! Index of the next instruction.
+  int here() const;
+
+  //! Makes the jump at `at` continue at the next instruction.
+  void patch(int at);
+
+  //! Returns a fresh temporary register.
+  int temp();
+
+  //! Current top of the temporary registers.
+  int mark() const { return top; }
+
+  //! Frees every temporary taken since `mark`, keeping variables.
+  void reset(int mark) { top = (mark > floor) ? mark : floor; }
+
+  //! Copies a register into another, writing straight to `dst` instead
+  //! if `src` is a temporary that the last instruction just produced.
+  void move(int dst, int src);
+
+  //! Lowers the lines of a block, whose variables are freed at its end.
+  void block(AST::BlockNode *b);
+
+  //! Returns the index of a numeric constant.
+  int constant(Value v);
+
+  //! Returns the index of a string constant, given as a quoted literal.
+  int string(const AST::View &literal);
+
+  //! Gives a register of the current function to a new variable.
+  int declare(AST::VariableNode *v);
+
+  //! Returns a register holding the value of a variable, loading it
+  //! through the static links if it belongs to an enclosing function.
+  int read(AST::VariableNode *v);
+
+  //! Stores a register on a variable.
+  void write(AST::VariableNode *v, int src);
+
+  //! Returns a register holding the address of a variable.
+  int address(AST::VariableNode *v);
+
+  //! Queues the body of a function to be built.
+  void define(AST::FuncNode *f);
+
+  //! Calls a function on the arguments held from register `args` on.
+  void call(AST::FuncNode *f, int args);
+
+  //! Reports a construct that the machine cannot run.
+  void error(const char *format, ...);
+
+private:
+  //! Register of a variable on the frames of a function.
+  struct Slot {
+    int function;
+    int reg;
+  };
+
+  //! Program being built.
+  Program &program;
+
+  //! Stream where errors are reported.
+  FILE *diagnostics;
+
+  //! Register of every declared variable.
+  std::unordered_map<const AST::VariableNode *, Slot> slots;
+
+  //! Index of every function met so far.
+  std::unordered_map<const AST::FuncNode *, int> indices;
+
+  //! Syntax tree of each function, by index.
+  std::vector<AST::FuncNode *> bodies;
+
+  //! Function being built.
+  int current = 0;
+
+  //! Nesting of blocks inside the function being built.
+  int nesting = 0;
+
+  //! First free register, and first one that is not a variable.
+  int top = 1, floor = 1;
+
+  //! Number of errors found.
+  int errors = 0;
+
+  //! Number of static links from the current function up to `f`, or -1
+  //! if `f` does not enclose it.
+  int hops(int f) const;
+};
+
+//! Interpreter of programs. Each call takes a frame of registers on a
+//! stack of values that never moves, so that pointers to variables stay
+//! valid while their function runs; the operations are dispatched with
+//! computed gotos where the compiler supports them.
+class Machine {
+public:
+  //! Basic constructor.
+  /*!
+   *  \param program  program to run.
+   *  \param size     number of values on the stack.
+   */
+  explicit Machine(const Program &program, std::size_t size = 1 << 20);
+
+  //! Basic destructor; frees every array.
+  ~Machine();
+
+  Machine(const Machine &) = delete;
+  Machine &operator=(const Machine &) = delete;
+
+  //! Runs the program, returning false after a runtime error.
+  /*!
+   *  \param diagnostics  stream where runtime errors are reported.
+   */
+  bool run(FILE *diagnostics);
+
+  //! Writes the value of every global variable, once the program has run
+  //! to its end without errors.
+  /*!
+   *  \param out      stream where the values are written.
+   */
+  void dump(FILE *out) const;
+
+private:
+  //! Frame of a caller, restored when the callee returns.
+  struct Frame {
+    const Instr *pc;
+    Value *base;
+    const Function *function;
+  };
+
+  //! Program being run.
+  const Program &program;
+
+  //! Registers of every active frame, left uninitialized until used.
+  std::unique_ptr<Value[]> stack;
+
+  //! Number of values on the stack.
+  std::size_t size;
+
+  //! Every array allocated by the program.
+  std::vector<Array *> heap;
+
+  //! Returns a new array of `n` zeros.
+  Array *allocate(std::size_t n);
+
+  //! Writes a single value of a certain type.
+  void print(FILE *out, Value v, int type) const;
+};
+
+} // namespace VM
@@ -0,0 +1,71 @@
+/*!
+ * Traversal of the abstract syntax tree of a language called
+ * Łukasiewicz, based on prefix notation.
+ *
+ *  \author Douglas Martins, Gustavo Zambonin, Marcello Klingelfus
+ */
+#pragma once
+
+#include <initializer_list>
+#include <vector>
+
+namespace AST {
+
+class Node;
+
+//! Walks of the tree that keep the work left to do on an explicit stack
+//! on the heap instead of the native one, so that expressions of any
+//! depth are printed, scanned and lowered without overflowing it.
+//!
+//! A node walks its children by handing its remaining work to `run` as
+//! steps instead of calling them. A step may visit a node last thing,
+//! by calling one of its methods; if that method walks in turn, its
+//! steps take the place of the step on the stack instead of nesting.
+//! Shallow walks, by far the most common, skip the stack and run their
+//! steps in place.
+namespace Walk {
+
+//! A piece of the work of a node: a function handed the step itself,
+//! and what it works with. Steps are plain values, cheap to copy around.
+struct Step {
+  //! Basic constructor.
+  Step(void (*work)(const Step &), Node *node, bool visits,
+       const char *text = nullptr, void *object = nullptr, int a = 0,
+       int b = 0)
+      : work(work), node(node), visits(visits), text(text), object(object),
+        a(a), b(b) {}
+
+  //! Work of the step.
+  void (*work)(const Step &);
+
+  //! Node the work is about; if `visits`, the work calls one of its
+  //! methods last thing.
+  Node *node;
+  bool visits;
+
+  //! Whatever else the work needs: some text, some object and numbers.
+  const char *text;
+  void *object;
+  int a, b;
+};
+
+//! Runs the steps of a node in order. Past a fixed depth of nodes
+//! walked in place, the steps go on the stack: called by a step that
+//! visits that very node, they take its place and run once it returns;
+//! called from anywhere else, they run before this returns. Returns
+//! whether the steps were left to the walk in progress.
+/*!
+ *  \param self     node whose work the steps are.
+ *  \param steps    work of the node, in order.
+ */
+bool run(const Node *self, std::initializer_list<Step> steps);
+bool run(const Node *self, const std::vector<Step> &steps);
+
+//! Values that steps hand to later ones, such as the registers where
+//! lowered operands are left; a walk starts and ends with as many as
+//! it found.
+std::vector<int> &values();
+
+} // namespace Walk
+
+} // namespace AST
@@ -0,0 +1,80 @@
+#include "arena.h"
+#include "ast.h"
+#include <cstring>
+
+namespace AST {
+
+/* Every allocation is aligned to the strictest fundamental alignment. */
+static const std::size_t _align = alignof(std::max_align_t);
+
+Arena::~Arena() { release(); }
+
+void *Arena::allocate(std::size_t size) {
+  size = (size + _align - 1) & ~(_align - 1);
+  allocated += size;
+
+  if (size > static_cast<std::size_t>(limit - cursor)) {
+    // oversized requests get a block of their own, so that the
+    // remainder of the current block is not wasted
+    if (size > blockSize / 4) {
+      char *b = static_cast<char *>(::operator new(size));
+      blocks.push_back(b);
+      return b;
+    }
+    cursor = static_cast<char *>(::operator new(blockSize));
+    limit = cursor + blockSize;
+    blocks.push_back(cursor);
+  }
+
+  void *p = cursor;
+  cursor += size;
+  return p;
+}
+
+void *Arena::allocateNode(std::size_t size) {
+  void *p = allocate(size);
+  // nodes use single inheritance, so the storage address is the
+  // address of the `Node` subobject once the object is constructed
+  owned.push_back(static_cast<Node *>(p));
+  return p;
+}
+
+char *Arena::copy(const char *s, std::size_t n, std::size_t pad) {
+  char *p = static_cast<char *>(allocate(n + pad));
+  std::memcpy(p, s, n);
+  std::memset(p + n, 0, pad);
+  return p;
+}
+
+void Arena::release() {
+  // children never outlive their parents, hence no particular
+  // order is needed, but reverse order mimics stack unwinding
+  for (auto it = owned.rbegin(); it != owned.rend(); ++it) {
+    (*it)->~Node();
+  }
+  for (char *b : blocks) {
+    ::operator delete(b);
+  }
+  owned.clear();
+  blocks.clear();
+  cursor = limit = nullptr;
+  allocated = 0;
+}
+
+void Arena::rewind(const Mark &m) {
+  for (std::size_t i = owned.size(); i > m.owned; --i) {
+    owned[i - 1]->~Node();
+  }
+  for (std::size_t i = m.blocks; i < blocks.size(); ++i) {
+    ::operator delete(blocks[i]);
+  }
+  // the block where the mark was taken is still there, and anything
+  // allocated on it since is simply handed out again
+  owned.resize(m.owned);
+  blocks.resize(m.blocks);
+  allocated = m.allocated;
+  cursor = m.cursor;
+  limit = m.limit;
+}
+
+} // namespace AST
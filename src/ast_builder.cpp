@@ -1,6 +1,6 @@
-#include <utility>
-
 #include "ast.h"
+#include "compiler.h"
+#include <algorithm>
 
 namespace AST {
 
@@ -30,13 +30,16 @@ NodeType operator%(NodeType t, int v) {
  * are the same if they have the same id and type.
  */
 bool operator==(const ParamNode &n1, const ParamNode &n2) {
-  std::string s1(n1.id), s2(n2.id);
-  return s1 == s2 && n1.type == n2.type;
+  return n1.id == n2.id && n1.type == n2.type;
 }
 
 Node::Node(int type) { this->type = static_cast<NodeType>(type); }
 
-std::string Node::_vtype(bool _short) {
+Node::Node(NodeKind kind, int type) : kind(kind) {
+  this->type = static_cast<NodeType>(type);
+}
+
+std::string Node::_vtype(bool _short) const {
   int n = this->_type();
   if (n < 0) {
     return "undefined";
@@ -53,16 +56,14 @@ std::string Node::_vtype(bool _short) {
   return t;
 }
 
-NodeType CharNode::_type() {
-  return (value[0] == '\"') ? this->type + 4 : this->type;
-}
-
 BinaryOpNode::BinaryOpNode(Operation binOp, Node *left, Node *right)
-    : binOp(binOp), left(left), right(right) {
+    : Node(BINARY_OP_NODE), binOp(binOp), left(left), right(right) {
   // transpiler needs to know if the variable was initialized
-  auto *v = dynamic_cast<VariableNode *>(left);
-  if (binOp == assign && v != nullptr) {
-    v->init = true;
+  if (binOp == assign) {
+    auto *v = node_cast<VariableNode>(left);
+    if (v != nullptr) {
+      v->init = true;
+    }
   }
 
   // coercion enforcing
@@ -81,23 +82,19 @@ BinaryOpNode::BinaryOpNode(Operation binOp, Node *left, Node *right)
   } else if (left->_type() == A_CHAR && right->_type() == CHAR) {
     this->right = new UnaryOpNode(cast_word, right);
   }
-  this->error_handler();
-}
 
-NodeType BinaryOpNode::_type() {
   if (binOp == index || binOp == append) {
-    // needs to return primitive type of element inside array
-    return left->_type() - 4;
+    // needs to be the primitive type of element inside array
+    this->type = this->left->_type() - 4;
+  } else {
+    this->type = (binOp < 8) ? this->left->_type() : BOOL;
   }
-  return (binOp < 8) ? left->_type() : BOOL;
-}
-
-BinaryOpNode::~BinaryOpNode() {
-  delete left;
-  delete right;
+  Stats::Timer check(compiler->stats, Stats::checking);
+  this->error_handler();
 }
 
-UnaryOpNode::UnaryOpNode(Operation op, Node *node) : op(op), node(node) {
+UnaryOpNode::UnaryOpNode(Operation op, Node *node)
+    : Node(UNARY_OP_NODE), op(op), node(node) {
   if (op == cast_int || op == len) {
     this->type = INT;
   } else if (op == cast_float) {
@@ -113,176 +110,231 @@ UnaryOpNode::UnaryOpNode(Operation op, Node *node) : op(op), node(node) {
   } else if (op == addr) {
     this->type = node->_type() + 8;
   }
+  Stats::Timer check(compiler->stats, Stats::checking);
   this->error_handler();
 }
 
-UnaryOpNode::~UnaryOpNode() { delete node; }
+BlockNode::BlockNode(Node *n) : Node(BLOCK_NODE) { push(n); }
 
-LinkedNode::~LinkedNode() { delete next; }
-
-BlockNode::BlockNode(Node *n) {
-  if (n != nullptr) {
-    nodeList.push_back(n);
+void BlockNode::compact() {
+  std::size_t kept = 0, h = 0;
+  for (std::size_t s = 0; s < statements.size(); ++s) {
+    for (; h < hoisted.size() && hoisted[h].before == s; ++h) {
+      hoisted[h].before = static_cast<std::uint32_t>(kept);
+    }
+    if (statements[s] != nullptr) {
+      statements[kept++] = statements[s];
+    }
   }
-}
-
-BlockNode::~BlockNode() {
-  for (Node *n : nodeList) {
-    delete n;
+  for (; h < hoisted.size(); ++h) {
+    hoisted[h].before = static_cast<std::uint32_t>(kept);
   }
+  statements.truncate(kept);
 }
 
 IfNode::IfNode(Node *condition, BlockNode *_then, BlockNode *_else)
-    : condition(condition), _then(_then), _else(_else) {
+    : Node(IF_NODE), condition(condition), _then(_then), _else(_else) {
+  Stats::Timer check(compiler->stats, Stats::checking);
   this->error_handler();
 }
 
-IfNode::~IfNode() {
-  delete condition;
-  delete _then;
-  delete _else;
-}
-
 ForNode::ForNode(Node *assign, Node *test, Node *iteration, BlockNode *body)
-    : assign(assign), test(test), iteration(iteration), body(body) {
+    : Node(FOR_NODE), assign(assign), test(test), iteration(iteration),
+      body(body) {
+  Stats::Timer check(compiler->stats, Stats::checking);
   this->error_handler();
 }
 
-ForNode::~ForNode() {
-  delete assign;
-  delete test;
-  delete iteration;
-  delete body;
-}
-
-FuncNode::FuncNode(std::string id, Node *params, int type, BlockNode *contents)
-    : Node(type), id(std::move(id)), params(params), contents(contents) {
+FuncNode::FuncNode(NodeKind kind, Name id, Node *params, int type,
+                   BlockNode *contents)
+    : Node(kind, type), id(id), params(params), contents(contents) {
+  Stats::Timer check(compiler->stats, Stats::checking);
   this->error_handler();
 }
 
 bool FuncNode::verifyParams(Node *n) {
-  auto *a = dynamic_cast<ParamNode *>(this->params);
-  auto *b = dynamic_cast<ParamNode *>(n);
+  auto *a = node_cast<ParamNode>(this->params);
+  auto *b = node_cast<ParamNode>(n);
 
   bool sameNode = true;
   while (sameNode && a != nullptr && b != nullptr) {
     sameNode = (*a == *b);
-    a = dynamic_cast<ParamNode *>(a->next);
-    b = dynamic_cast<ParamNode *>(b->next);
+    a = node_cast<ParamNode>(a->next);
+    b = node_cast<ParamNode>(b->next);
   }
 
   return a == nullptr && b == nullptr && sameNode;
 }
 
-FuncNode::~FuncNode() {
-  delete params;
-  delete contents;
-}
-
 std::deque<VariableNode *> FuncNode::createDeque() {
   std::deque<VariableNode *> v = {};
-  auto *l = dynamic_cast<VariableNode *>(this->params);
+  auto *l = node_cast<VariableNode>(this->params);
   while (l != nullptr) {
     v.push_front(l);
-    l = dynamic_cast<VariableNode *>(l->next);
+    l = node_cast<VariableNode>(l->next);
   }
   return v;
 }
 
+std::vector<Node *> MessageNode::line() const {
+  std::vector<Node *> v;
+  Node *n = next;
+  while (n != nullptr) {
+    v.push_back(n);
+    auto *a = node_cast<BinaryOpNode>(n);
+    auto *d = node_cast<DeclarationNode>((a != nullptr) ? a->left : n);
+    n = (d != nullptr) ? d->next : nullptr;
+  }
+  std::reverse(v.begin(), v.end());
+  return v;
+}
+
 FuncCallNode::FuncCallNode(FuncNode *function, BlockNode *params)
-    : function(function), params(params) {
+    : Node(FUNC_CALL_NODE, function->_type()), function(function),
+      params(params) {
+  Stats::Timer check(compiler->stats, Stats::checking);
   this->error_handler();
 }
 
-NodeType FuncCallNode::_type() { return this->function->_type(); }
-
-FuncCallNode::~FuncCallNode() { delete params; }
-
-HiOrdFuncNode::HiOrdFuncNode(const std::string &id, Node *func,
-                             VariableNode *array)
-    : FuncNode(array->id + "_" + id,
-               new ParamNode(array->id, nullptr, array->_type(), array->size),
+HiOrdFuncNode::HiOrdFuncNode(NodeKind kind, Name id, Node *func,
+                             VarRefNode *array)
+    : FuncNode(kind, intern(*array->decl->id + "_" + *id),
+               new ParamNode(array->decl->id, nullptr, array->_type(),
+                             array->decl->size),
                array->_type(), new BlockNode(func)) {
+  Stats::Timer check(compiler->stats, Stats::checking);
   this->hi_error_handler(array);
 }
 
-HiOrdFuncNode *HiOrdFuncNode::chooseFunc(const std::string &id, Node *func,
-                                         VariableNode *array) {
-  if (id == "map") {
+HiOrdFuncNode *HiOrdFuncNode::chooseFunc(Name id, Node *func,
+                                         VarRefNode *array) {
+  if (*id == "map") {
     return new MapFuncNode(id, func, array);
   }
-  if (id == "fold") {
+  if (*id == "fold") {
     return new FoldFuncNode(id, func, array);
   }
-  if (id == "filter") {
+  if (*id == "filter") {
     return new FilterFuncNode(id, func, array);
   }
   return nullptr;
 }
 
-MapFuncNode::MapFuncNode(const std::string &fid, Node *func,
-                         VariableNode *array)
-    : HiOrdFuncNode(fid, func, array) {
-  std::string id = array->id, ti = id + "_ti", ta = id + "_ta";
-  std::ostringstream out;
-  int n = array->_type(), s = array->size;
-
-  auto tmp = new Node(n - 4);
-  std::string t = (n < 3) ? "int" : tmp->_vtype(true);
-  delete tmp;
-
-  out << "int " << ti << "\n"
-      << t << " " << ta << "[" << s << "]\nfor " << ti << " = 0, " << ti
-      << " < [len] " << id << ", " << ti << " = " << ti << " + 1 {\n  " << ta
-      << "[" << ti << "] = λ(" << id << "[" << ti << "])\n}\n";
-
-  this->contents->nodeList.push_back(string_read(out.str().c_str()));
-  VariableNode *v = new VariableNode(ta, nullptr, n, s);
-  this->contents->nodeList.push_back(new ReturnNode(v));
-  this->hi_error_handler(func);
+/* Type of the elements of an array; an invalid array, which was already
+   reported, is taken to hold integers. */
+static int _element(VarRefNode *array) {
+  int n = array->_type();
+  return (n < 3) ? INT : n - 4;
 }
 
-FoldFuncNode::FoldFuncNode(const std::string &fid, Node *func,
-                           VariableNode *array)
-    : HiOrdFuncNode(fid, func, array) {
-  this->type = this->type - 4;
-  std::string id = array->id, ti = id + "_ti", tv = id + "_tv";
-  std::ostringstream out;
-
-  auto tmp = new Node(array->_type() - 4);
-  out << tmp->_vtype(true) << " " << tv << "\n"
-      << tv << " = " << id << "[0]\nint " << ti << "\nfor " << ti << " = 1, "
-      << ti << " < [len] " << id << ", " << ti << " = " << ti << " + 1 {\n  "
-      << tv << " = " << tv << " + λ(" << tv << ", " << array->id << "[" << ti
-      << "])\n}\n";
-  delete tmp;
-
-  this->contents->nodeList.push_back(string_read(out.str().c_str()));
-  VariableNode *v = new VariableNode(tv, nullptr, array->_type() % 4, 0);
-  this->contents->nodeList.push_back(new ReturnNode(v));
-  this->hi_error_handler(func);
+/* Declares a temporary of a desugared function, as a line of its body. */
+static DeclarationNode *_temp(BlockNode *block, const std::string &id,
+                              int type, int size) {
+  auto *d = new DeclarationNode(intern(id), nullptr, type, size);
+  block->push(new MessageNode(d, type));
+  return d;
 }
 
-FilterFuncNode::FilterFuncNode(const std::string &fid, Node *func,
-                               VariableNode *array)
-    : HiOrdFuncNode(fid, func, array) {
-  std::string id = array->id, ti = id + "_ti", ta = id + "_ta";
-  std::ostringstream out;
-  int n = array->_type();
+/* Loop `for i = from, i < [len] array, i = i + 1` with an empty body, so
+   that the body is built after the header, as the parser does. */
+static ForNode *_loop(DeclarationNode *i, int from, VariableNode *array) {
+  Node *first = new BinaryOpNode(assign, new VarRefNode(i), new IntNode(from));
+  Node *length = new UnaryOpNode(len, new VarRefNode(array));
+  Node *test = new BinaryOpNode(lt, new VarRefNode(i), length);
+  Node *sum = new BinaryOpNode(add, new VarRefNode(i), new IntNode(1));
+  Node *step = new BinaryOpNode(assign, new VarRefNode(i), sum);
+  return new ForNode(first, test, step, new BlockNode());
+}
+
+/* Element `array[i]`. */
+static Node *_at(VariableNode *array, DeclarationNode *i) {
+  return new BinaryOpNode(index, new VarRefNode(array), new VarRefNode(i));
+}
 
-  auto tmp = new Node(n - 4);
-  std::string t = (n < 3) ? "int" : tmp->_vtype(true);
-  delete tmp;
+/*
+ * The bodies below are built in the order the parser would reduce the
+ * equivalent source, so that diagnostics come out in that order too:
+ *
+ *   map                    fold                    filter
+ *   int a_ti               t a_tv                  int a_ti
+ *   t a_ta[size]           a_tv = a[0]             t a_ta[0]
+ *   for a_ti = 0, ... {    int a_ti                for a_ti = 0, ... {
+ *     a_ta[a_ti] =         for a_ti = 1, ... {       if λ(a[a_ti])
+ *       λ(a[a_ti])           a_tv = a_tv +           then { a_ta <- a[a_ti] }
+ *   }                          λ(a_tv, a[a_ti])    }
+ *                          }
+ */
 
-  out << "int " << ti << "\n"
-      << t << " " << ta << "[0]\nfor " << ti << " = 0, " << ti << " < [len] "
-      << id << ", " << ti << " = " << ti << " + 1 {\n  if λ(" << id << "[" << ti
-      << "])\n  then {\n    " << ta << " <- " << id << "[" << ti
-      << "]\n  }\n}\n";
+MapFuncNode::MapFuncNode(Name fid, Node *func, VarRefNode *array)
+    : HiOrdFuncNode(MAP_FUNC_NODE, fid, func, array) {
+  std::string id = *array->decl->id;
+  int s = array->decl->size, t = _element(array);
+  auto *param = node_cast<ParamNode>(this->params);
+  auto *lambda = node_cast<FuncNode>(func);
+  auto *block = new BlockNode();
+
+  DeclarationNode *ti = _temp(block, id + "_ti", INT, 0);
+  DeclarationNode *ta = _temp(block, id + "_ta", t + 4, s);
+
+  ForNode *loop = _loop(ti, 0, param);
+  Node *call = new FuncCallNode(lambda, new BlockNode(_at(param, ti)));
+  Node *left = new BinaryOpNode(index, new VarRefNode(ta), new VarRefNode(ti));
+  loop->body->push(new BinaryOpNode(assign, left, call));
+  block->push(loop);
+
+  this->contents->push(block);
+  this->contents->push(new ReturnNode(new VarRefNode(ta)));
+  Stats::Timer check(compiler->stats, Stats::checking);
+  this->hi_error_handler(func);
+}
+
+FoldFuncNode::FoldFuncNode(Name fid, Node *func, VarRefNode *array)
+    : HiOrdFuncNode(FOLD_FUNC_NODE, fid, func, array) {
+  this->type = this->type - 4;
+  std::string id = *array->decl->id;
+  auto *param = node_cast<ParamNode>(this->params);
+  auto *lambda = node_cast<FuncNode>(func);
+  auto *block = new BlockNode();
+
+  DeclarationNode *tv = _temp(block, id + "_tv", _element(array), 0);
+  Node *first = new BinaryOpNode(index, new VarRefNode(param), new IntNode(0));
+  block->push(new BinaryOpNode(assign, new VarRefNode(tv), first));
+  DeclarationNode *ti = _temp(block, id + "_ti", INT, 0);
+
+  ForNode *loop = _loop(ti, 1, param);
+  auto *params = new BlockNode(new VarRefNode(tv));
+  params->push(_at(param, ti));
+  Node *call = new FuncCallNode(lambda, params);
+  Node *sum = new BinaryOpNode(add, new VarRefNode(tv), call);
+  loop->body->push(new BinaryOpNode(assign, new VarRefNode(tv), sum));
+  block->push(loop);
+
+  this->contents->push(block);
+  this->contents->push(new ReturnNode(new VarRefNode(tv)));
+  Stats::Timer check(compiler->stats, Stats::checking);
+  this->hi_error_handler(func);
+}
 
-  this->contents->nodeList.push_back(string_read(out.str().c_str()));
-  VariableNode *v = new VariableNode(ta, nullptr, n, array->size);
-  this->contents->nodeList.push_back(new ReturnNode(v));
+FilterFuncNode::FilterFuncNode(Name fid, Node *func, VarRefNode *array)
+    : HiOrdFuncNode(FILTER_FUNC_NODE, fid, func, array) {
+  std::string id = *array->decl->id;
+  int t = _element(array);
+  auto *param = node_cast<ParamNode>(this->params);
+  auto *lambda = node_cast<FuncNode>(func);
+  auto *block = new BlockNode();
+
+  DeclarationNode *ti = _temp(block, id + "_ti", INT, 0);
+  DeclarationNode *ta = _temp(block, id + "_ta", t + 4, 0);
+
+  ForNode *loop = _loop(ti, 0, param);
+  Node *call = new FuncCallNode(lambda, new BlockNode(_at(param, ti)));
+  Node *push = new BinaryOpNode(append, new VarRefNode(ta), _at(param, ti));
+  loop->body->push(new IfNode(call, new BlockNode(push), new BlockNode()));
+  block->push(loop);
+
+  this->contents->push(block);
+  this->contents->push(new ReturnNode(new VarRefNode(ta)));
+  Stats::Timer check(compiler->stats, Stats::checking);
   this->hi_error_handler(func);
 }
 
@@ -0,0 +1,314 @@
+#include "ast.h"
+#include "vm.h"
+#include "walk.h"
+#include <cstdlib>
+
+namespace AST {
+
+/* Integer operations, in the order of the arithmetic and logic members
+   of `Operation`, from `add` to `_or`; -1 where there is none. */
+static const int _int[] = {VM::ADDI, VM::SUBI, VM::MULI, VM::DIVI, -1,
+                           -1,       -1,       -1,       VM::EQI,  VM::NEI,
+                           VM::GTI,  VM::LTI,  VM::GEI,  VM::LEI,  VM::AND,
+                           VM::OR};
+
+/* Float operations, in the same order. */
+static const int _float[] = {VM::ADDF, VM::SUBF, VM::MULF, VM::DIVF, -1,
+                             -1,       -1,       -1,       VM::EQF,  VM::NEF,
+                             VM::GTF,  VM::LTF,  VM::GEF,  VM::LEF,  -1,
+                             -1};
+
+/* Register returned by a lowering left to the walk in progress, which
+   hands the actual one to the next steps on its values. */
+static const int _later = -2;
+
+/* Step of a walk that lowers an operand, handing on where it is left. */
+static Walk::Step _operand(Node *n, VM::Builder &b) {
+  return {[](const Walk::Step &t) {
+            int r = t.node->lower(*static_cast<VM::Builder *>(t.object));
+            if (r != _later) {
+              Walk::values().push_back(r);
+            }
+          },
+          n, true, nullptr, &b};
+}
+
+/* Takes the value handed on by the last step to give one. */
+static int _take() {
+  int r = Walk::values().back();
+  Walk::values().pop_back();
+  return r;
+}
+
+/* Lowers an expression whose steps end by handing on its register,
+   returning that register unless the walk in progress is left to. */
+static int _lower(const Node *self, std::initializer_list<Walk::Step> steps) {
+  return Walk::run(self, steps) ? _later : _take();
+}
+
+int IntNode::lower(VM::Builder &b) {
+  int dst = b.temp();
+  b.emitk(VM::LOADI, dst, value);
+  return dst;
+}
+
+int FloatNode::lower(VM::Builder &b) {
+  VM::Value v;
+  v.f = std::strtod(value.str().c_str(), nullptr);
+  int dst = b.temp();
+  b.emit(VM::LOADK, dst, b.constant(v));
+  return dst;
+}
+
+int BoolNode::lower(VM::Builder &b) {
+  int dst = b.temp();
+  b.emitk(VM::LOADI, dst, value);
+  return dst;
+}
+
+int CharNode::lower(VM::Builder &b) {
+  int dst = b.temp();
+  if (type == CHAR) {
+    b.emitk(VM::LOADI, dst, static_cast<unsigned char>(value.data[1]));
+  } else {
+    b.emit(VM::LOADS, dst, b.string(value));
+  }
+  return dst;
+}
+
+int BinaryOpNode::lower(VM::Builder &b) {
+  if (binOp == assign) {
+    auto *r = node_cast<VarRefNode>(left);
+    auto *d = node_cast<DeclarationNode>(left);
+    auto *i = node_cast<BinaryOpNode>(left);
+    auto *u = node_cast<UnaryOpNode>(left);
+    if (r != nullptr || d != nullptr) {
+      VariableNode *v = (r != nullptr) ? r->decl : d;
+      if (d != nullptr) {
+        d->lower(b);
+      }
+      b.write(v, right->lower(b));
+    } else if (i != nullptr && i->binOp == index) {
+      int array = i->left->lower(b), at = i->right->lower(b);
+      b.emit(VM::SETIDX, array, at, right->lower(b));
+    } else if (u != nullptr && u->op == ref) {
+      int pointer = u->node->lower(b);
+      b.emit(VM::STORE, pointer, right->lower(b));
+    } else {
+      b.error("left hand side of attribution cannot be assigned");
+    }
+    return -1;
+  }
+
+  if (binOp == append) {
+    int array = left->lower(b);
+    b.emit(VM::APPEND, array, right->lower(b));
+    return -1;
+  }
+
+  Walk::Step last = {[](const Walk::Step &t) {
+                       auto &b = *static_cast<VM::Builder *>(t.object);
+                       int r = _take(), l = _take();
+                       b.reset(t.a);
+                       Walk::values().push_back(
+                           static_cast<BinaryOpNode *>(t.node)->operate(b, l, r));
+                     },
+                     this, false, nullptr, &b, b.mark()};
+  return _lower(this, {_operand(left, b), _operand(right, b), last});
+}
+
+int BinaryOpNode::operate(VM::Builder &b, int l, int r) {
+  int dst = b.temp();
+  if (binOp == index) {
+    b.emit(VM::INDEX, dst, l, r);
+  } else if (!notArray(left)) {
+    // arrays are joined or ordered like strings, element by element
+    if (binOp == add) {
+      b.emit(VM::CONCAT, dst, l, r);
+    } else if (binOp >= eq && binOp <= leq) {
+      b.emit(VM::CMPARR, dst, l, r, left->_type() % 4 == FLOAT);
+      int zero = b.temp();
+      b.emitk(VM::LOADI, zero, 0);
+      b.emit(static_cast<VM::Op>(_int[binOp]), dst, dst, zero);
+    } else {
+      b.error("%s arrays cannot be operated on", left->_vtype(false).c_str());
+    }
+  } else {
+    int op = (left->_type() == FLOAT) ? _float[binOp] : _int[binOp];
+    if (op < 0) {
+      b.error("%s values cannot be operated on",
+              left->_vtype(false).c_str());
+    } else {
+      b.emit(static_cast<VM::Op>(op), dst, l, r);
+    }
+  }
+  return dst;
+}
+
+int UnaryOpNode::lower(VM::Builder &b) {
+  if (op == addr) {
+    auto *r = node_cast<VarRefNode>(node);
+    auto *i = node_cast<BinaryOpNode>(node);
+    auto *u = node_cast<UnaryOpNode>(node);
+    if (r != nullptr) {
+      return b.address(r->decl);
+    }
+    if (u != nullptr && u->op == ref) {
+      // the address of what a pointer points to is the pointer itself
+      return u->node->lower(b);
+    }
+    if (i != nullptr && i->binOp == index) {
+      int mark = b.mark();
+      int array = i->left->lower(b), at = i->right->lower(b);
+      b.reset(mark);
+      int dst = b.temp();
+      b.emit(VM::ADDRIDX, dst, array, at);
+      return dst;
+    }
+    b.error("address operation expects a variable or array item");
+    return b.temp();
+  }
+
+  Walk::Step last = {[](const Walk::Step &t) {
+                       auto &b = *static_cast<VM::Builder *>(t.object);
+                       int n = _take();
+                       Walk::values().push_back(
+                           static_cast<UnaryOpNode *>(t.node)->operate(b, n, t.a));
+                     },
+                     this, false, nullptr, &b, b.mark()};
+  return _lower(this, {_operand(node, b), last});
+}
+
+int UnaryOpNode::operate(VM::Builder &b, int n, int mark) {
+  int from = node->_type();
+  if (!notArray(node) && op != ref && op != len && op != cast_word) {
+    b.error("%s arrays cannot be operated on", node->_vtype(false).c_str());
+    return n;
+  }
+
+  // casts between types stored alike leave the value as it is
+  VM::Op code;
+  if (op == ref) {
+    code = VM::LOAD;
+  } else if (op == uminus) {
+    code = (from == FLOAT) ? VM::NEGF : VM::NEGI;
+  } else if (op == _not) {
+    code = VM::NOT;
+  } else if (op == cast_int || op == cast_float) {
+    if ((from == FLOAT) == (op == cast_float)) {
+      return n;
+    }
+    code = (from == FLOAT) ? VM::FTOI : VM::ITOF;
+  } else if (op == cast_bool) {
+    code = (from == FLOAT) ? VM::FTOB : VM::ITOB;
+  } else if (op == cast_word) {
+    if (!notArray(node)) {
+      return n;
+    }
+    if (from != CHAR && from != INT) {
+      b.error("%s values cannot be cast to words",
+              node->_vtype(false).c_str());
+    }
+    code = (from == CHAR) ? VM::CTOS : VM::ITOS;
+  } else {
+    code = VM::LEN;
+  }
+
+  b.reset(mark);
+  int dst = b.temp();
+  b.emit(code, dst, n);
+  return dst;
+}
+
+int VarRefNode::lower(VM::Builder &b) { return b.read(decl); }
+
+int BlockNode::lower(VM::Builder &b) {
+  b.block(this);
+  return -1;
+}
+
+int MessageNode::lower(VM::Builder &b) {
+  for (Node *d : line()) {
+    d->lower(b);
+  }
+  return -1;
+}
+
+int IfNode::lower(VM::Builder &b) {
+  // a branch always taken, as folding leaves them, needs no test
+  auto *c = node_cast<BoolNode>(condition);
+  if (c != nullptr && c->value && _else->empty()) {
+    _then->lower(b);
+    return -1;
+  }
+
+  int mark = b.mark();
+  int skip = b.emitk(VM::JUMPF, condition->lower(b), 0);
+  b.reset(mark);
+  _then->lower(b);
+  if (!_else->empty()) {
+    int end = b.emitk(VM::JUMP, 0, 0);
+    b.patch(skip);
+    _else->lower(b);
+    b.patch(end);
+  } else {
+    b.patch(skip);
+  }
+  return -1;
+}
+
+int ForNode::lower(VM::Builder &b) {
+  // the test is placed after the body, so each iteration takes one jump
+  int mark = b.mark();
+  assign->lower(b);
+  b.reset(mark);
+  int start = b.emitk(VM::JUMP, 0, 0), loop = b.here();
+  body->lower(b);
+  iteration->lower(b);
+  b.reset(mark);
+  b.patch(start);
+  b.emitk(VM::JUMPT, test->lower(b), loop);
+  b.reset(mark);
+  return -1;
+}
+
+int FuncNode::lower(VM::Builder &b) {
+  b.define(this);
+  return -1;
+}
+
+int ReturnNode::lower(VM::Builder &b) {
+  b.emit(VM::RET, next->lower(b));
+  return -1;
+}
+
+int FuncCallNode::lower(VM::Builder &b) {
+  // arguments are gathered on consecutive registers, where the result
+  // of the call is left
+  int n = params->size(), args = b.mark();
+  for (int i = 0; i < n; ++i) {
+    b.temp();
+  }
+  for (int i = 0; i < n; ++i) {
+    b.move(args + i, (*params)[i]->lower(b));
+    b.reset(args + n);
+  }
+  if (n == 0) {
+    b.temp();
+  }
+  b.call(function, args);
+  b.reset(args + 1);
+  return args;
+}
+
+int DeclarationNode::lower(VM::Builder &b) {
+  int reg = b.declare(this);
+  if (notArray(this)) {
+    b.emitk(VM::LOADI, reg, 0);
+  } else {
+    b.emitk(VM::NEWARR, reg, size);
+  }
+  return reg;
+}
+
+} // namespace AST
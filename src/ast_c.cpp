@@ -0,0 +1,656 @@
+#include "ast.h"
+#include "walk.h"
+#include <unordered_map>
+#include <unordered_set>
+
+namespace AST {
+
+/* Runtime support written at the top of every program. Arrays are
+   pointers to their items, with their length and capacity stored right
+   before them, so that indexing is plain C. Built with LUKA_DUMP, a
+   program ends writing its globals the way the virtual machine does. */
+static const char *const _prelude = R"(#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  size_t len, cap;
+} luka_header;
+
+typedef void *luka_ref;
+
+#define luka_len(a) ((int)((const luka_header *)(a))[-1].len)
+
+#define luka_append(a, v)                                                      \
+  ((a) = luka_grow((a), sizeof *(a)), (a)[luka_len(a) - 1] = (v))
+
+static inline void *luka_array(size_t n, size_t size) {
+  luka_header *h = calloc(1, sizeof(luka_header) + n * size);
+  if (h == NULL) {
+    abort();
+  }
+  h->len = h->cap = n;
+  return h + 1;
+}
+
+static inline void *luka_grow(void *a, size_t size) {
+  luka_header *h = (luka_header *)a - 1;
+  if (h->len == h->cap) {
+    h->cap = 2 * h->cap + 1;
+    h = realloc(h, sizeof(luka_header) + h->cap * size);
+    if (h == NULL) {
+      abort();
+    }
+  }
+  h->len++;
+  return h + 1;
+}
+
+static inline void *luka_concat(const void *a, const void *b, size_t size) {
+  size_t m = luka_len(a), n = luka_len(b);
+  char *c = luka_array(m + n, size);
+  memcpy(c, a, m * size);
+  memcpy(c + m * size, b, n * size);
+  return c;
+}
+
+static inline char *luka_string(const char *s, size_t n) {
+  char *a = luka_array(n, 1);
+  memcpy(a, s, n);
+  return a;
+}
+
+static inline char *luka_char(char c) { return luka_string(&c, 1); }
+
+static inline char *luka_itos(int i) {
+  char s[16];
+  return luka_string(s, sprintf(s, "%d", i));
+}
+
+#define LUKA_COMPARE(name, T)                                                  \
+  static inline int name(const void *a, const void *b) {                       \
+    const T *x = a, *y = b;                                                    \
+    int m = luka_len(a), n = luka_len(b), i;                                   \
+    for (i = 0; i < m && i < n; ++i) {                                         \
+      if (x[i] != y[i]) {                                                      \
+        return (x[i] < y[i]) ? -1 : 1;                                         \
+      }                                                                        \
+    }                                                                          \
+    return (m > n) - (m < n);                                                  \
+  }
+
+LUKA_COMPARE(luka_compare_int, int)
+LUKA_COMPARE(luka_compare_float, double)
+LUKA_COMPARE(luka_compare_bool, bool)
+LUKA_COMPARE(luka_compare_char, char)
+LUKA_COMPARE(luka_compare_ref, luka_ref)
+
+#ifdef LUKA_DUMP
+static inline void luka_dump_int(int i) { printf("%d", i); }
+
+static inline void luka_dump_float(double f) {
+  char s[32];
+  int p;
+  for (p = 1; p <= 17; ++p) {
+    sprintf(s, "%.*g", p, f);
+    if (strtod(s, NULL) == f) {
+      break;
+    }
+  }
+  printf(strpbrk(s, ".eni") == NULL ? "%s.0" : "%s", s);
+}
+
+static inline void luka_dump_bool(bool b) { printf(b ? "true" : "false"); }
+
+static inline void luka_dump_char(char c) { printf("'%c'", c); }
+
+static inline void luka_dump_ref(luka_ref p) {
+  printf(p != NULL ? "ref" : "null");
+}
+
+static inline void luka_dump_chars(const char *a) {
+  printf("\"%.*s\"", luka_len(a), a);
+}
+
+#define LUKA_DUMP_ARRAY(name, T, item)                                         \
+  static inline void name(const T *a) {                                        \
+    int i;                                                                     \
+    printf("[");                                                               \
+    for (i = 0; i < luka_len(a); ++i) {                                        \
+      printf(i > 0 ? ", " : "");                                               \
+      item(a[i]);                                                              \
+    }                                                                          \
+    printf("]");                                                               \
+  }
+
+LUKA_DUMP_ARRAY(luka_dump_ints, int, luka_dump_int)
+LUKA_DUMP_ARRAY(luka_dump_floats, double, luka_dump_float)
+LUKA_DUMP_ARRAY(luka_dump_bools, bool, luka_dump_bool)
+LUKA_DUMP_ARRAY(luka_dump_refs, luka_ref, luka_dump_ref)
+#endif
+)";
+
+/* String representation for the operations. */
+static const std::string _bin[] = {
+    " + ",  " - ",  " * ",  " / ",  " = ",    "",          "(&",
+    "(*",   " == ", " != ", " > ",  " < ",    " >= ",      " <= ",
+    " && ", " || ", "(-",   "(!",   "((int)", "((double)", "((bool)"};
+
+/* C names of the primitive types. */
+static const char *const _base[] = {"int", "double", "bool", "char"};
+
+/* Suffixes of the comparisons between arrays, by type of their items. */
+static const char *const _items[] = {"int", "float", "bool", "char"};
+
+//! Takes a single line of code and indents it with two spaces.
+#define _tab(X)                                                                \
+  output->spaces += 2;                                                         \
+  (X);                                                                         \
+  output->spaces -= 2
+
+namespace {
+
+/* Function hoisted to the top level of the program. */
+struct Hoisted {
+  FuncNode *node;
+  std::string name;
+
+  //! Variables of the functions around it that it reaches, whose
+  //! addresses are passed after its parameters.
+  std::vector<VariableNode *> captures;
+  std::unordered_set<const VariableNode *> captured;
+
+  //! Name of the parameter holding each address.
+  std::unordered_map<const VariableNode *, std::string> pointers;
+};
+
+/* Program being written. */
+struct Unit {
+  //! Every function, the first being `main`.
+  std::vector<Hoisted> functions;
+  std::unordered_map<const FuncNode *, int> indices;
+  std::unordered_set<std::string> names;
+
+  //! Function that declares each variable.
+  std::unordered_map<const VariableNode *, int> owners;
+
+  //! Variables of the outermost block, kept at the top level.
+  std::vector<VariableNode *> globals;
+  std::unordered_set<const VariableNode *> global;
+
+  //! Every call, from caller to callee.
+  std::vector<std::pair<int, int>> calls;
+
+  //! Function being written.
+  int current = 0;
+};
+
+thread_local Unit *_unit;
+
+} // namespace
+
+/* C type of a node type, such as `int *`. */
+static std::string _ctype(int type) {
+  type = (type < 0) ? INT : type;
+  int stars = type / 8 + ((type % 8 >= 4) ? 1 : 0);
+  return _base[type % 4] + std::string(stars > 0 ? " " : "") +
+         std::string(stars, '*');
+}
+
+/* Declaration of a name of a certain type, such as `int **p`. */
+static std::string _declarator(int type, const std::string &name) {
+  std::string t = _ctype(type);
+  return t + ((t.back() == '*') ? "" : " ") + name;
+}
+
+/* Start of the call that writes a value of a certain type, as the
+   virtual machine writes it. */
+static std::string _dump(int type) {
+  type = (type < 0) ? INT : type;
+  if (type == A_CHAR) {
+    return "luka_dump_chars(";
+  } else if (type % 8 >= 4 && type - 4 >= 8) {
+    return "luka_dump_refs((const luka_ref *)";
+  } else if (type % 8 >= 4) {
+    return "luka_dump_" + std::string(_items[type % 4]) + "s(";
+  } else if (type >= 8) {
+    return "luka_dump_ref(";
+  }
+  return "luka_dump_" + std::string(_items[type % 4]) + "(";
+}
+
+/* Name of a variable; every name gets a trailing underscore, so that
+   none of them clashes with C keywords or with the runtime. */
+static std::string _name(const VariableNode *v) { return *v->id + "_"; }
+
+/* Literal as C source, escaping what C reads differently. */
+static std::string _quote(const View &v) {
+  std::string s;
+  for (std::size_t i = 0; i < v.size; ++i) {
+    if (i > 0 && i + 1 < v.size && (v.data[i] == '\\' || v.data[i] == '?')) {
+      s += '\\';
+    }
+    s += v.data[i];
+  }
+  return s;
+}
+
+/* Adds a variable to those a function reaches outside of itself. */
+static bool _capture(int f, VariableNode *v) {
+  Hoisted &h = _unit->functions[f];
+  if (!h.captured.insert(v).second) {
+    return false;
+  }
+  h.captures.push_back(v);
+  return true;
+}
+
+static void _scan(Node *n, int f, int depth);
+
+/* Step of a walk that scans a child. */
+static Walk::Step _visit(Node *n, int f, int depth) {
+  return {[](const Walk::Step &t) { _scan(t.node, t.a, t.b); }, n, true,
+          nullptr, nullptr, f, depth};
+}
+
+/* Gives a function its index and C name, and scans its body. */
+static int _define(FuncNode *fn) {
+  Unit &u = *_unit;
+  int i = u.functions.size();
+  std::string base = *fn->id + "_fn", name = base;
+  for (int k = 2; u.names.count(name) != 0; ++k) {
+    name = base + std::to_string(k);
+  }
+  u.names.insert(name);
+  u.indices[fn] = i;
+  u.functions.push_back({fn, name, {}, {}, {}});
+
+  if (fn->contents != nullptr) {
+    for (VariableNode *p : fn->createDeque()) {
+      u.owners[p] = i;
+    }
+    _scan(fn->contents, i, 0);
+  } else {
+    yyserror("function %s is declared but never defined", fn->id->c_str());
+  }
+  return i;
+}
+
+/* Finds the functions, variables and calls of a subtree, as seen from
+   function `f`; `depth` counts the blocks open inside that function. */
+static void _scan(Node *n, int f, int depth) {
+  Unit &u = *_unit;
+  if (n == nullptr) {
+    return;
+  }
+  switch (n->kind) {
+  case BINARY_OP_NODE:
+    Walk::run(n, {_visit(static_cast<BinaryOpNode *>(n)->left, f, depth),
+                  _visit(static_cast<BinaryOpNode *>(n)->right, f, depth)});
+    break;
+  case UNARY_OP_NODE:
+    Walk::run(n, {_visit(static_cast<UnaryOpNode *>(n)->node, f, depth)});
+    break;
+  case VAR_REF_NODE: {
+    VariableNode *v = static_cast<VarRefNode *>(n)->decl;
+    auto o = u.owners.find(v);
+    if (o != u.owners.end() && o->second != f && u.global.count(v) == 0) {
+      _capture(f, v);
+    }
+    break;
+  }
+  case BLOCK_NODE:
+    for (Node *m : *static_cast<BlockNode *>(n)) {
+      _scan(m, f, depth + 1);
+    }
+    break;
+  case IF_NODE:
+    _scan(static_cast<IfNode *>(n)->condition, f, depth);
+    _scan(static_cast<IfNode *>(n)->_then, f, depth);
+    _scan(static_cast<IfNode *>(n)->_else, f, depth);
+    break;
+  case FOR_NODE:
+    _scan(static_cast<ForNode *>(n)->assign, f, depth);
+    _scan(static_cast<ForNode *>(n)->test, f, depth);
+    _scan(static_cast<ForNode *>(n)->iteration, f, depth);
+    _scan(static_cast<ForNode *>(n)->body, f, depth);
+    break;
+  case FUNC_CALL_NODE: {
+    // functors on the first line of a block never make it into the
+    // tree, and belong to the function that calls them
+    auto *c = static_cast<FuncCallNode *>(n);
+    auto i = u.indices.find(c->function);
+    int callee = (i != u.indices.end()) ? i->second : _define(c->function);
+    u.calls.push_back({f, callee});
+    _scan(c->params, f, depth);
+    break;
+  }
+  case MESSAGE_NODE:
+    for (Node *d : static_cast<MessageNode *>(n)->line()) {
+      _scan(d, f, depth);
+    }
+    break;
+  case RETURN_NODE:
+    _scan(static_cast<ReturnNode *>(n)->next, f, depth);
+    break;
+  case DECLARATION_NODE:
+    u.owners[static_cast<VariableNode *>(n)] = f;
+    if (f == 0 && depth == 1) {
+      u.globals.push_back(static_cast<VariableNode *>(n));
+      u.global.insert(static_cast<VariableNode *>(n));
+    }
+    break;
+  case FUNC_NODE:
+  case HI_ORD_FUNC_NODE:
+  case MAP_FUNC_NODE:
+  case FOLD_FUNC_NODE:
+  case FILTER_FUNC_NODE:
+    if (u.indices.count(static_cast<FuncNode *>(n)) == 0) {
+      _define(static_cast<FuncNode *>(n));
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+/* A caller must also reach whatever its callees reach outside of it,
+   passing the addresses along; this runs until nothing changes. */
+static void _close() {
+  Unit &u = *_unit;
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (const std::pair<int, int> &c : u.calls) {
+      for (std::size_t i = 0; i < u.functions[c.second].captures.size(); ++i) {
+        VariableNode *v = u.functions[c.second].captures[i];
+        if (u.owners[v] != c.first && _capture(c.first, v)) {
+          changed = true;
+        }
+      }
+    }
+  }
+
+  // a function may reach two variables of the same name
+  for (Hoisted &h : u.functions) {
+    std::unordered_map<std::string, int> seen;
+    for (VariableNode *v : h.captures) {
+      int k = seen[*v->id]++;
+      h.pointers[v] = *v->id + "_ref" + (k > 0 ? std::to_string(k) : "");
+    }
+  }
+}
+
+/* Prints a variable as seen from the function being written. */
+static void _variable(VariableNode *v) {
+  Hoisted &h = _unit->functions[_unit->current];
+  auto p = h.pointers.find(v);
+  text((p != h.pointers.end()) ? "(*" + p->second + ")" : _name(v), 0);
+}
+
+/* Prints the head of a function, without a trailing newline. */
+static void _signature(const Hoisted &h) {
+  std::string s = "static " + _declarator(h.node->_type(), h.name) + "(";
+  std::deque<VariableNode *> params = h.node->createDeque();
+  for (VariableNode *p : params) {
+    s += _declarator(p->_type(), _name(p)) + ", ";
+  }
+  for (VariableNode *v : h.captures) {
+    s += _declarator(v->_type() + 8, h.pointers.at(v)) + ", ";
+  }
+  if (params.empty() && h.captures.empty()) {
+    s += "void, ";
+  }
+  s.erase(s.size() - 2);
+  text(s + ")", 0);
+}
+
+/* Prints the declaration of a variable as a line. */
+static void _declare(DeclarationNode *d, Node *value) {
+  bool global = _unit->global.count(d) != 0;
+  if (global && value == nullptr && notArray(d)) {
+    // globals start zeroed
+    return;
+  }
+  text(global ? _name(d) : _declarator(d->_type(), _name(d)), output->spaces);
+  text(" = ", 0);
+  if (value != nullptr) {
+    value->printC();
+  } else if (notArray(d)) {
+    text("0", 0);
+  } else {
+    text("luka_array(" + std::to_string(d->size) + ", sizeof(" +
+             _ctype(d->_type() - 4) + "))",
+         0);
+  }
+  text(";\n", 0);
+}
+
+/* Step of a walk that writes some text, then a child as C if there is
+   one. */
+static Walk::Step _c(const char *s, Node *n = nullptr) {
+  return {[](const Walk::Step &t) {
+            text(t.text, 0);
+            if (t.node != nullptr) {
+              t.node->printC();
+            }
+          },
+          n, true, s};
+}
+
+/* Step of a walk that writes the size of the items of an array type. */
+static Walk::Step _sizeof(int type) {
+  return {[](const Walk::Step &t) {
+            text(", sizeof(" + _ctype(t.a) + "))", 0);
+          },
+          nullptr, false, nullptr, nullptr, type};
+}
+
+/* Step of a walk that writes the addresses a call hands to its callee,
+   after `a` arguments, and closes the call. */
+static Walk::Step _captures(FuncCallNode *c, int a) {
+  return {[](const Walk::Step &t) {
+            const Hoisted &caller = _unit->functions[_unit->current];
+            const Hoisted &callee = _unit->functions[_unit->indices.at(
+                static_cast<FuncCallNode *>(t.node)->function)];
+            const char *comma = (t.a > 0) ? ", " : "";
+            for (VariableNode *v : callee.captures) {
+              auto p = caller.pointers.find(v);
+              text(comma, 0);
+              text((p != caller.pointers.end()) ? p->second : "&" + _name(v),
+                   0);
+              comma = ", ";
+            }
+            text(")", 0);
+          },
+          c, false, nullptr, nullptr, a};
+}
+
+void IntNode::printC() { text(value, 0); }
+
+void FloatNode::printC() { text(value, 0); }
+
+void BoolNode::printC() { text(value ? "true" : "false", 0); }
+
+void CharNode::printC() {
+  if (type == CHAR) {
+    text(_quote(value), 0);
+  } else {
+    text("luka_string(" + _quote(value) + ", " +
+             std::to_string(value.size - 2) + ")",
+         0);
+  }
+}
+
+void BinaryOpNode::printC() {
+  auto *d = node_cast<DeclarationNode>(left);
+  if (binOp == assign && d != nullptr) {
+    _declare(d, right);
+    return;
+  }
+
+  if (binOp == index) {
+    Walk::run(this, {_c("", left), _c("[", right), _c("]")});
+  } else if (binOp == append) {
+    Walk::run(this, {_c("luka_append(", left), _c(", ", right), _c(")")});
+  } else if (binOp == assign) {
+    Walk::run(this, {_c("", left), _c(_bin[binOp].c_str(), right)});
+  } else if (!notArray(left) && binOp == add) {
+    Walk::run(this, {_c("luka_concat(", left), _c(", ", right),
+                     _sizeof(left->_type() - 4)});
+  } else if (!notArray(left)) {
+    // arrays are ordered item by item, like strings
+    int t = left->_type() - 4;
+    text("(luka_compare_" + std::string(t >= 8 ? "ref" : _items[t % 4]) + "(",
+         0);
+    Walk::run(this, {_c("", left), _c(", ", right), _c(")"),
+                     _c(_bin[binOp].c_str()), _c("0)")});
+  } else if (binOp < assign && left->_type() >= 8) {
+    // the language does arithmetic on pointers as on integers
+    text("((" + _ctype(left->_type()) + ")((intptr_t)", 0);
+    Walk::run(this, {_c("", left), _c(_bin[binOp].c_str()),
+                     _c("(intptr_t)", right), _c("))")});
+  } else {
+    Walk::run(this, {_c("(", left), _c(_bin[binOp].c_str(), right), _c(")")});
+  }
+}
+
+void UnaryOpNode::printC() {
+  if (op == cast_word && !notArray(node)) {
+    Walk::run(this, {_c("", node)});
+    return;
+  }
+  if (op == cast_word) {
+    text((node->_type() == CHAR) ? "luka_char(" : "luka_itos(", 0);
+  } else if (op == len) {
+    text("luka_len(", 0);
+  } else {
+    text(_bin[op], 0);
+  }
+  Walk::run(this, {_c("", node), _c(")")});
+}
+
+void VarRefNode::printC() { _variable(decl); }
+
+void BlockNode::printC() {
+  for (Node *n : *this) {
+    if (FuncNode::classof(n)) {
+      // functions are written apart, at the top level
+      continue;
+    }
+    if (MessageNode::classof(n) || IfNode::classof(n) ||
+        ForNode::classof(n) || BlockNode::classof(n)) {
+      n->printC();
+    } else {
+      text("", output->spaces);
+      n->printC();
+      text(";\n", 0);
+    }
+  }
+}
+
+void MessageNode::printC() {
+  for (Node *d : line()) {
+    d->printC();
+  }
+}
+
+void IfNode::printC() {
+  text("if (", output->spaces);
+  condition->printC();
+  text(") {\n", 0);
+  _tab(_then->printC());
+  if (!_else->empty()) {
+    text("} else {\n", output->spaces);
+    _tab(_else->printC());
+  }
+  text("}\n", output->spaces);
+}
+
+void ForNode::printC() {
+  text("for (", output->spaces);
+  assign->printC();
+  text("; ", 0);
+  test->printC();
+  text("; ", 0);
+  iteration->printC();
+  text(") {\n", 0);
+  _tab(body->printC());
+  text("}\n", output->spaces);
+}
+
+void FuncNode::printC() {
+  int outer = _unit->current;
+  _unit->current = _unit->indices.at(this);
+  _signature(_unit->functions[_unit->current]);
+  text(" {\n", 0);
+  _tab(contents->printC());
+  text("}\n", 0);
+  _unit->current = outer;
+}
+
+void ReturnNode::printC() {
+  text("return ", 0);
+  next->printC();
+}
+
+void FuncCallNode::printC() {
+  text(_unit->functions[_unit->indices.at(function)].name + "(", 0);
+  std::vector<Walk::Step> steps;
+  for (Node *n : *params) {
+    steps.push_back(_c(steps.empty() ? "" : ", ", n));
+  }
+  steps.push_back(_captures(this, steps.size()));
+  Walk::run(this, steps);
+}
+
+void DeclarationNode::printC() { _declare(this, nullptr); }
+
+void emitC(BlockNode *root) {
+  Unit unit, *outer = _unit;
+  _unit = &unit;
+  unit.functions.push_back({nullptr, "main", {}, {}, {}});
+  _scan(root, 0, 0);
+  _close();
+
+  text(_prelude, 0);
+  if (!unit.globals.empty()) {
+    text("\n", 0);
+  }
+  for (VariableNode *v : unit.globals) {
+    text("static " + _declarator(v->_type(), _name(v)) + ";\n", 0);
+  }
+  if (unit.functions.size() > 1) {
+    text("\n", 0);
+  }
+  for (std::size_t i = 1; i < unit.functions.size(); ++i) {
+    if (unit.functions[i].node->contents != nullptr) {
+      _signature(unit.functions[i]);
+      text(";\n", 0);
+    }
+  }
+  for (std::size_t i = 1; i < unit.functions.size(); ++i) {
+    if (unit.functions[i].node->contents != nullptr) {
+      text("\n", 0);
+      unit.functions[i].node->printC();
+    }
+  }
+
+  text("\nint main(void) {\n", 0);
+  _tab(root->printC());
+  if (!unit.globals.empty()) {
+    // built with LUKA_DUMP, the program ends writing its globals
+    text("#ifdef LUKA_DUMP\n", 0);
+    for (VariableNode *v : unit.globals) {
+      text("  printf(\"" + *v->id + " = \");\n", 0);
+      text("  " + _dump(v->_type()) + _name(v) + ");\n", 0);
+      text("  printf(\"\\n\");\n", 0);
+    }
+    text("#endif\n", 0);
+  }
+  text("  return 0;\n}\n", 0);
+  _unit = outer;
+}
+
+} // namespace AST
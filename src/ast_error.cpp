@@ -24,30 +24,39 @@ static const std::string _opt[] = {"addition",
                                    "length",
                                    "append"};
 
+/* Returns the declaration behind a variable or a reference to it. */
+static VariableNode *_variable(Node *n) {
+  auto *r = node_cast<VarRefNode>(n);
+  return (r != nullptr) ? r->decl : node_cast<VariableNode>(n);
+}
+
 void BinaryOpNode::error_handler() {
-  auto *v1 = dynamic_cast<VariableNode *>(left);
-  auto *v2 = dynamic_cast<VariableNode *>(right);
-  auto *f1 = dynamic_cast<FuncCallNode *>(right);
+  VariableNode *v1 = _variable(left);
+  VariableNode *v2 = _variable(right);
+  auto *f1 = node_cast<FuncCallNode>(right);
   unsigned int n = 0;
 
   if (v2 != nullptr) {
     n = v2->size;
+  } else if (f1 != nullptr && FilterFuncNode::classof(f1->function)) {
+    // a filtered array grows as needed, up to the size of its input
+    n = node_cast<ParamNode>(f1->function->params)->size;
   } else if (f1 != nullptr && !notArray(f1->function)) {
-    n = dynamic_cast<VariableNode *>(
-            dynamic_cast<ReturnNode *>(f1->function->contents->nodeList.back())
-                ->next)
-            ->size;
+    Node *last = f1->function->contents->back();
+    auto *r = node_cast<ReturnNode>(last);
+    VariableNode *v = (r != nullptr) ? _variable(r->next) : nullptr;
+    n = (v != nullptr) ? v->size : 0;
   }
   if (v1 != nullptr && (v1->size < n)) {
     yyserror("operation between mismatched array sizes");
   }
 
   if (left->_type() == A_CHAR && right->_type() == A_CHAR) {
-    auto *c = dynamic_cast<CharNode *>(right);
-    if (c != nullptr && v1 != nullptr && v1->size < c->value.size() - 2) {
-      c->value.resize(v1->size + 1UL);
-      c->value += R"(")";
-      yyerror("warning: value truncated to %s", c->value.c_str());
+    auto *c = node_cast<CharNode>(right);
+    if (c != nullptr && v1 != nullptr && v1->size < c->value.size - 2) {
+      std::string s = c->value.str().substr(0, v1->size + 1UL) + R"(")";
+      c->value = {arena->copy(s.data(), s.size()), s.size()};
+      yyerror("warning: value truncated to %s", s.c_str());
     }
   }
 
@@ -65,12 +74,9 @@ void BinaryOpNode::error_handler() {
     if (notArray(left)) {
       yyserror("left hand side of append operation is not an array");
     } else if ((left->_type() % 4) != right->_type()) {
-      auto n = new Node(left->_type() % 4);
+      Node n(left->_type() % 4);
       yyserror("append operation expected %s but received %s",
-               n->_vtype(false).c_str(), right->_vtype(false).c_str());
-      delete n;
-    } else {
-      dynamic_cast<VariableNode *>(left)->size++;
+               n._vtype(false).c_str(), right->_vtype(false).c_str());
     }
   } else if (differentTypes && bothValid) {
     yyserror("%s operation expected %s but received %s", _opt[binOp].c_str(),
@@ -84,8 +90,8 @@ void UnaryOpNode::error_handler() {
   } else if (op == len && notArray(node)) {
     yyserror("length operation expects an array");
   } else if (op == addr) {
-    bool isNotVar = (dynamic_cast<VariableNode *>(node) == nullptr);
-    auto *indexNode = dynamic_cast<BinaryOpNode *>(node);
+    bool isNotVar = (_variable(node) == nullptr);
+    auto *indexNode = node_cast<BinaryOpNode>(node);
     bool isNotIndex = (indexNode != nullptr && indexNode->binOp != index);
     if ((indexNode == nullptr && isNotVar) || isNotIndex) {
       yyserror("address operation expects a variable or array item");
@@ -109,16 +115,16 @@ void ForNode::error_handler() {
 
 void FuncNode::error_handler() {
   if (contents != nullptr) {
-    Node *ret = contents->nodeList.back();
-    bool isReturn = (dynamic_cast<ReturnNode *>(ret) != nullptr);
-    if (type != ret->_type() && isReturn) {
-      yyserror("function %s has incoherent return type", id.c_str());
+    Node *ret = contents->back();
+    bool isReturn = ret != nullptr && ReturnNode::classof(ret);
+    if (isReturn && type != ret->_type()) {
+      yyserror("function %s has incoherent return type", id->c_str());
     }
   }
 }
 
 void FuncCallNode::error_handler() {
-  std::vector<Node *> callParam = params->nodeList;
+  BlockNode &callParam = *params;
   int callSize = callParam.size();
 
   std::deque<VariableNode *> origParam = function->createDeque();
@@ -126,12 +132,12 @@ void FuncCallNode::error_handler() {
 
   if (origSize != callSize) {
     yyserror("function %s expects %d parameters but received %d",
-             function->id.c_str(), origSize, callSize);
+             function->id->c_str(), origSize, callSize);
   } else {
     for (int i = 0; i < origSize; ++i) {
       if (origParam[i]->_type() != callParam[i]->_type()) {
         yyserror("parameter %s expected %s but received %s",
-                 origParam[i]->id.c_str(), origParam[i]->_vtype(false).c_str(),
+                 origParam[i]->id->c_str(), origParam[i]->_vtype(false).c_str(),
                  callParam[i]->_vtype(false).c_str());
       }
     }
@@ -145,7 +151,7 @@ void HiOrdFuncNode::hi_error_handler(Node *array) {
 }
 
 void MapFuncNode::hi_error_handler(Node *func) {
-  auto *f = dynamic_cast<FuncNode *>(func);
+  auto *f = node_cast<FuncNode>(func);
   if (f->_type() != (this->type - 4)) {
     yyserror("function lambda has incoherent return type");
   }
@@ -156,7 +162,7 @@ void MapFuncNode::hi_error_handler(Node *func) {
 }
 
 void FoldFuncNode::hi_error_handler(Node *func) {
-  auto *f = dynamic_cast<FuncNode *>(func);
+  auto *f = node_cast<FuncNode>(func);
   if (f->_type() != this->type) {
     yyserror("function lambda has incoherent return type");
   }
@@ -167,7 +173,7 @@ void FoldFuncNode::hi_error_handler(Node *func) {
 }
 
 void FilterFuncNode::hi_error_handler(Node *func) {
-  auto *f = dynamic_cast<FuncNode *>(func);
+  auto *f = node_cast<FuncNode>(func);
   if (f->_type() != BOOL) {
     yyserror("function lambda has incoherent return type");
   }
@@ -0,0 +1,437 @@
+#include "ast.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace AST {
+
+/* Value of an integer literal. */
+static bool _value(const Node *n, long long &v) {
+  if (n->kind != INT_NODE) {
+    return false;
+  }
+  v = static_cast<const IntNode *>(n)->value;
+  return true;
+}
+
+/* Value of a float literal, as every target reads its text. */
+static bool _value(const Node *n, double &v) {
+  if (n->kind != FLOAT_NODE) {
+    return false;
+  }
+  v = std::strtod(static_cast<const FloatNode *>(n)->value.str().c_str(),
+                  nullptr);
+  return true;
+}
+
+/* Value of a boolean literal. */
+static bool _value(const Node *n, bool &v) {
+  if (n->kind != BOOL_NODE) {
+    return false;
+  }
+  v = static_cast<const BoolNode *>(n)->value;
+  return true;
+}
+
+/* Integer literal, or `otherwise` if the value does not fit the 32-bit
+   integers of C, on which the other targets agree. */
+static Node *_literal(long long v, Node *otherwise) {
+  return (v > INT32_MIN && v <= INT32_MAX) ? new IntNode(static_cast<int>(v))
+                                           : otherwise;
+}
+
+/* Float literal, written as the shortest text that reads back to the same
+   value. Literals of the language have no exponent, so a value that needs
+   one is written in full if it is not too large or too small, and is
+   `otherwise` left unfolded, as is one that is not a number. */
+static Node *_literal(double v, Node *otherwise) {
+  if (!std::isfinite(v)) {
+    return otherwise;
+  }
+  char text[64];
+  for (int precision = 1; precision <= 17; ++precision) {
+    std::snprintf(text, sizeof(text), "%.*g", precision, v);
+    if (std::strtod(text, nullptr) == v) {
+      break;
+    }
+  }
+  if (std::strchr(text, 'e') != nullptr) {
+    if (std::fabs(v) >= 1e16 || std::fabs(v) < 1e-6) {
+      return otherwise;
+    }
+    for (int decimals = 1; decimals <= 22; ++decimals) {
+      std::snprintf(text, sizeof(text), "%.*f", decimals, v);
+      if (std::strtod(text, nullptr) == v) {
+        break;
+      }
+    }
+    if (std::strtod(text, nullptr) != v) {
+      return otherwise;
+    }
+  }
+  std::size_t n = std::strlen(text);
+  if (std::strchr(text, '.') == nullptr) {
+    text[n++] = '.';
+    text[n++] = '0';
+  }
+  return new FloatNode({arena->copy(text, n), n});
+}
+
+/* Boolean literal. */
+static Node *_literal(bool v) { return new BoolNode(v); }
+
+/* Whether a node is a number literal of a value. */
+static bool _is(const Node *n, long long v) {
+  long long i;
+  double x;
+  return (_value(n, i) && i == v) || (_value(n, x) && x == v);
+}
+
+/* Operation on two integer literals. Divisions are left as they are,
+   since Python divides integers into floats where the other targets
+   truncate, and no literal is what every target computes. */
+static Node *_integers(BinaryOpNode *b, long long i, long long j) {
+  switch (b->binOp) {
+  case add:
+    return _literal(i + j, b);
+  case sub:
+    return _literal(i - j, b);
+  case mul:
+    return _literal(i * j, b);
+  case eq:
+    return _literal(i == j);
+  case neq:
+    return _literal(i != j);
+  case gt:
+    return _literal(i > j);
+  case lt:
+    return _literal(i < j);
+  case geq:
+    return _literal(i >= j);
+  case leq:
+    return _literal(i <= j);
+  default:
+    return b;
+  }
+}
+
+/* Operation on two float literals; a division by zero is left to fail
+   when the program runs. */
+static Node *_reals(BinaryOpNode *b, double x, double y) {
+  switch (b->binOp) {
+  case add:
+    return _literal(x + y, b);
+  case sub:
+    return _literal(x - y, b);
+  case mul:
+    return _literal(x * y, b);
+  case div:
+    return (y != 0) ? _literal(x / y, b) : b;
+  case eq:
+    return _literal(x == y);
+  case neq:
+    return _literal(x != y);
+  case gt:
+    return _literal(x > y);
+  case lt:
+    return _literal(x < y);
+  case geq:
+    return _literal(x >= y);
+  case leq:
+    return _literal(x <= y);
+  default:
+    return b;
+  }
+}
+
+/* Operation on two boolean literals. */
+static Node *_booleans(BinaryOpNode *b, bool p, bool q) {
+  switch (b->binOp) {
+  case _and:
+    return _literal(p && q);
+  case _or:
+    return _literal(p || q);
+  case eq:
+    return _literal(p == q);
+  case neq:
+    return _literal(p != q);
+  default:
+    return b;
+  }
+}
+
+/* Folds a binary operation whose operands are folded already. Operands
+   left as they are by the other one are kept only if they have the type
+   of the operation; adding a float zero is not among them, since it
+   turns a negative zero into a positive one. */
+static Node *_binary(BinaryOpNode *b) {
+  Node *l = b->left, *r = b->right;
+  long long i, j;
+  double x, y;
+  bool p, q;
+  if (_value(l, i) && _value(r, j)) {
+    return _integers(b, i, j);
+  }
+  if (_value(l, x) && _value(r, y)) {
+    return _reals(b, x, y);
+  }
+  if (_value(l, p) && _value(r, q)) {
+    return _booleans(b, p, q);
+  }
+
+  bool number = (b->type == INT || b->type == FLOAT);
+  bool keepsLeft = (l->type == b->type), keepsRight = (r->type == b->type);
+  switch (b->binOp) {
+  case add:
+    if (b->type == INT && keepsLeft && _is(r, 0)) {
+      return l;
+    }
+    if (b->type == INT && keepsRight && _is(l, 0)) {
+      return r;
+    }
+    break;
+  case sub:
+    if (number && keepsLeft && _is(r, 0)) {
+      return l;
+    }
+    break;
+  case mul:
+    if (number && keepsLeft && _is(r, 1)) {
+      return l;
+    }
+    if (number && keepsRight && _is(l, 1)) {
+      return r;
+    }
+    break;
+  case div:
+    // dividing an integer by one makes it a float in Python
+    if (b->type == FLOAT && keepsLeft && _is(r, 1)) {
+      return l;
+    }
+    break;
+  case _and:
+  case _or:
+    // `b & true` and `b | false` are `b`
+    if (_value(r, q) && q == (b->binOp == _and) && l->type == BOOL) {
+      return l;
+    }
+    if (_value(l, p) && p == (b->binOp == _and) && r->type == BOOL) {
+      return r;
+    }
+    break;
+  default:
+    break;
+  }
+  return b;
+}
+
+/* Folds a unary operation whose operand is folded already. */
+static Node *_unary(UnaryOpNode *u) {
+  Node *n = u->node;
+  long long i;
+  double x;
+  bool p;
+  bool cast = (u->op == cast_int || u->op == cast_float || u->op == cast_bool);
+  if (cast && n->type == u->type) {
+    return n;
+  }
+
+  switch (u->op) {
+  case uminus:
+    if (_value(n, i)) {
+      return _literal(-i, u);
+    }
+    if (_value(n, x)) {
+      return _literal(-x, u);
+    }
+    break;
+  case _not:
+    if (_value(n, p)) {
+      return _literal(!p);
+    }
+    if (n->kind == UNARY_OP_NODE && static_cast<UnaryOpNode *>(n)->op == _not &&
+        static_cast<UnaryOpNode *>(n)->node->type == BOOL) {
+      return static_cast<UnaryOpNode *>(n)->node;
+    }
+    break;
+  case cast_int:
+    // every target truncates floats towards zero
+    if (_value(n, x) && std::fabs(x) < 2147483648.0) {
+      return _literal(static_cast<long long>(x), u);
+    }
+    if (_value(n, p)) {
+      return _literal(static_cast<long long>(p), u);
+    }
+    break;
+  case cast_float:
+    if (_value(n, i)) {
+      return _literal(static_cast<double>(i), u);
+    }
+    if (_value(n, p)) {
+      return _literal(p ? 1.0 : 0.0, u);
+    }
+    break;
+  case cast_bool:
+    if (_value(n, i)) {
+      return _literal(i != 0);
+    }
+    if (_value(n, x)) {
+      return _literal(x != 0);
+    }
+    break;
+  default:
+    break;
+  }
+  return u;
+}
+
+/* Keeps only the branch of an `if` that is taken, if its condition is
+   folded to a constant, as the `then` block of an `if true`; the branch
+   keeps its own scope. Returns null if that branch is empty. */
+static Node *_branch(IfNode *f) {
+  bool p;
+  if (!_value(f->condition, p)) {
+    return f;
+  }
+  if (!p) {
+    std::swap(f->_then, f->_else);
+    f->condition = _literal(true);
+  }
+  f->_else->clear();
+  return f->_then->empty() ? nullptr : f;
+}
+
+/* Folds a node whose children are folded already, returning what takes
+   its place, which may be null for a statement. */
+static Node *_fold(Node *n) {
+  if (n == nullptr) {
+    return n;
+  }
+  switch (n->kind) {
+  case BINARY_OP_NODE:
+    return _binary(static_cast<BinaryOpNode *>(n));
+  case UNARY_OP_NODE:
+    return _unary(static_cast<UnaryOpNode *>(n));
+  case IF_NODE:
+    return _branch(static_cast<IfNode *>(n));
+  default:
+    return n;
+  }
+}
+
+/* Replaces the children of a node, already folded, by what takes their
+   place. */
+static void _settle(Node *n) {
+  switch (n->kind) {
+  case BINARY_OP_NODE: {
+    auto *b = static_cast<BinaryOpNode *>(n);
+    b->left = _fold(b->left);
+    b->right = _fold(b->right);
+    break;
+  }
+  case UNARY_OP_NODE: {
+    auto *u = static_cast<UnaryOpNode *>(n);
+    u->node = _fold(u->node);
+    break;
+  }
+  case BLOCK_NODE: {
+    auto *b = static_cast<BlockNode *>(n);
+    for (std::size_t i = 0; i < b->size(); ++i) {
+      b->replace(i, _fold((*b)[i]));
+    }
+    b->compact();
+    break;
+  }
+  case IF_NODE: {
+    auto *f = static_cast<IfNode *>(n);
+    f->condition = _fold(f->condition);
+    break;
+  }
+  case FOR_NODE: {
+    auto *l = static_cast<ForNode *>(n);
+    l->assign = _fold(l->assign);
+    l->test = _fold(l->test);
+    l->iteration = _fold(l->iteration);
+    break;
+  }
+  case RETURN_NODE: {
+    auto *r = static_cast<ReturnNode *>(n);
+    r->next = _fold(r->next);
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+void fold(BlockNode *root) {
+  // nodes are settled after their children, on a stack of their own so
+  // that expressions of any depth are folded; functions are met once,
+  // where they are defined or else where they are first called
+  std::vector<std::pair<Node *, bool>> stack = {{root, false}};
+  std::unordered_set<const Node *> functions;
+  auto push = [&stack](Node *n) {
+    if (n != nullptr) {
+      stack.emplace_back(n, false);
+    }
+  };
+
+  while (!stack.empty()) {
+    Node *n = stack.back().first;
+    if (stack.back().second) {
+      stack.pop_back();
+      _settle(n);
+      continue;
+    }
+    stack.back().second = true;
+
+    switch (n->kind) {
+    case BINARY_OP_NODE:
+      push(static_cast<BinaryOpNode *>(n)->left);
+      push(static_cast<BinaryOpNode *>(n)->right);
+      break;
+    case UNARY_OP_NODE:
+      push(static_cast<UnaryOpNode *>(n)->node);
+      break;
+    case BLOCK_NODE:
+      for (Node *s : *static_cast<BlockNode *>(n)) {
+        push(s);
+      }
+      break;
+    case IF_NODE:
+      push(static_cast<IfNode *>(n)->condition);
+      push(static_cast<IfNode *>(n)->_then);
+      push(static_cast<IfNode *>(n)->_else);
+      break;
+    case FOR_NODE:
+      push(static_cast<ForNode *>(n)->assign);
+      push(static_cast<ForNode *>(n)->test);
+      push(static_cast<ForNode *>(n)->iteration);
+      push(static_cast<ForNode *>(n)->body);
+      break;
+    case FUNC_CALL_NODE: {
+      auto *c = static_cast<FuncCallNode *>(n);
+      push(c->params);
+      if (functions.insert(c->function).second) {
+        push(c->function->contents);
+      }
+      break;
+    }
+    case RETURN_NODE:
+      push(static_cast<ReturnNode *>(n)->next);
+      break;
+    default:
+      if (FuncNode::classof(n) && functions.insert(n).second) {
+        push(static_cast<FuncNode *>(n)->contents);
+      }
+      break;
+    }
+  }
+}
+
+} // namespace AST
@@ -1,4 +1,5 @@
 #include "ast.h"
+#include "walk.h"
 
 namespace AST {
 
@@ -9,21 +10,38 @@ static const std::string _bin[] = {
     ">=",      "<=",       "&",       "|",       " -u",    " !",
     " [int]",  " [float]", " [bool]", " [word]", " [len]", "[append]"};
 
-//! Saves the current indentation status.
-static int spaces;
-
 //! Takes a single line of code and indents it with two spaces.
 #define _tab(X)                                                                \
-  spaces += 2;                                                                 \
+  output->spaces += 2;                                                         \
   (X);                                                                         \
-  spaces -= 2
+  output->spaces -= 2
 
 //! Variadic macro that prevents indentation for any number of lines.
 #define _notab(...)                                                            \
-  int tmp = spaces;                                                            \
-  spaces = 0;                                                                  \
+  int tmp = output->spaces;                                                    \
+  output->spaces = 0;                                                          \
   (__VA_ARGS__);                                                               \
-  spaces = tmp;
+  output->spaces = tmp;
+
+/* Step of a walk that prints a child in prefix notation. */
+static Walk::Step _prefix(Node *n) {
+  return {[](const Walk::Step &t) { t.node->printPrefix(); }, n, true};
+}
+
+/* Step of a walk that writes some text, then a child in usual notation. */
+static Walk::Step _infix(const char *s, int spaces, Node *n) {
+  return {[](const Walk::Step &t) {
+            text(t.text, t.a);
+            t.node->printInfix();
+          },
+          n, true, s, nullptr, spaces};
+}
+
+/* Step of a walk that restores the indentation of the output. */
+static Walk::Step _indent(int spaces) {
+  return {[](const Walk::Step &t) { output->spaces = t.a; }, nullptr, false,
+          nullptr, nullptr, spaces};
+}
 
 void IntNode::printInfix() { text(value, 1); }
 
@@ -36,109 +54,115 @@ void CharNode::printInfix() { text(value, 1); }
 void BinaryOpNode::printPrefix() {
   bool space = ((binOp != assign) && (binOp != append));
   text("", static_cast<int>(space));
-  text(_bin[binOp], spaces);
-  _notab(left->printPrefix(), right->printPrefix());
+  text(_bin[binOp], output->spaces);
+  int spaces = output->spaces;
+  output->spaces = 0;
+  Walk::run(this, {_prefix(left), _prefix(right), _indent(spaces)});
 }
 
 void BinaryOpNode::printInfix() {
   bool space = ((binOp == assign) || (binOp == append));
-  _notab(left->printInfix(), text("", static_cast<int>(space)),
-         text(_bin[binOp], spaces), right->printInfix());
+  int spaces = output->spaces;
+  output->spaces = 0;
+  Walk::run(this, {_infix("", 0, left),
+                   _infix(_bin[binOp].c_str(), static_cast<int>(space), right),
+                   _indent(spaces)});
 }
 
 void UnaryOpNode::printInfix() { this->printPrefix(); }
 
 void UnaryOpNode::printPrefix() {
   text(_bin[op], 0);
-  node->printPrefix();
+  Walk::run(this, {_prefix(node)});
 }
 
-void VariableNode::printInfix() { text(id, 1); }
+void VariableNode::printInfix() { text(*id, 1); }
+
+void VarRefNode::printInfix() { text(*decl->id, 1); }
 
 void BlockNode::printPrefix() {
-  for (Node *n : nodeList) {
-    if (n != nullptr) {
-      n->printPrefix();
-      if (dynamic_cast<FuncNode *>(n) == nullptr && n->_type() != ND) {
-        text("\n", 0);
-      }
+  for (Node *n : *this) {
+    n->printPrefix();
+    if (!FuncNode::classof(n) && n->_type() != ND) {
+      text("\n", 0);
     }
   }
 }
 
 void MessageNode::printPrefix() {
   std::string s = (notArray(this)) ? " var:" : ":";
-  text(this->_vtype(true) + s, spaces);
-  next->printInfix();
+  text(this->_vtype(true) + s, output->spaces);
+  const char *comma = "";
+  for (Node *n : line()) {
+    text(comma, 0);
+    n->printInfix();
+    comma = ",";
+  }
 }
 
 void IfNode::printPrefix() {
-  text("if:", spaces);
+  text("if:", output->spaces);
   _notab(condition->printPrefix());
   text("\n", 0);
-  text("then:\n", spaces);
+  text("then:\n", output->spaces);
   _tab(_then->printPrefix());
-  if (!_else->nodeList.empty()) {
-    text("else:\n", spaces);
+  if (!_else->empty()) {
+    text("else:\n", output->spaces);
     _tab(_else->printPrefix());
   }
 }
 
 void ForNode::printPrefix() {
-  text("for: ", spaces);
+  text("for: ", output->spaces);
   _notab(assign->printPrefix(), text(",", 0), test->printPrefix(),
          text(", ", 0), iteration->printPrefix());
   text("\n", 0);
-  text("do:\n", spaces);
+  text("do:\n", output->spaces);
   _tab(body->printPrefix());
 }
 
 void FuncNode::printPrefix() {
   if (this->contents != nullptr) {
-    text(this->_vtype(true) + " fun: " + this->id + " (params: ", spaces);
-    if (params != nullptr) {
-      params->printInfix();
+    text(this->_vtype(true) + " fun: " + *this->id + " (params: ",
+         output->spaces);
+    const char *comma = "";
+    for (VariableNode *p : createDeque()) {
+      if (p->_type() != ND) {
+        text(comma, 0);
+        p->printInfix();
+        comma = ", ";
+      }
     }
     text(")\n", 0);
     _tab(contents->printPrefix());
   } else {
-    yyserror("function %s is declared but never defined", this->id.c_str());
+    yyserror("function %s is declared but never defined", this->id->c_str());
   }
 }
 
-void ParamNode::printInfix() {
-  if (this->_type() != ND) {
-    if (next != nullptr) {
-      next->printInfix();
-      text(", ", 0);
-    }
-    text(this->_vtype(true) + " " + id, 0);
-  }
-}
+void ParamNode::printInfix() { text(this->_vtype(true) + " " + *id, 0); }
 
 void ReturnNode::printPrefix() {
-  text("ret", spaces);
+  text("ret", output->spaces);
   _notab(next->printPrefix());
 }
 
 void FuncCallNode::printPrefix() {
-  std::string psize = std::to_string(params->nodeList.size());
-  text(" " + function->id + "[" + psize + " params]", spaces);
-  for (Node *n : params->nodeList) {
-    n->printPrefix();
+  std::string psize = std::to_string(params->size());
+  text(" " + *function->id + "[" + psize + " params]", output->spaces);
+  std::vector<Walk::Step> steps;
+  for (Node *n : *params) {
+    steps.push_back(_prefix(n));
   }
+  Walk::run(this, steps);
 }
 
 void DeclarationNode::printInfix() {
-  if (next != nullptr) {
-    next->printInfix();
-    text(",", 0);
-  }
   std::string s;
   if (!notArray(this)) {
     s = " (size: " + std::to_string(this->size) + ")";
   }
-  text(id + s, 1);
+  text(*id + s, 1);
 }
 
 } // namespace AST
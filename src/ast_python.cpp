@@ -1,4 +1,8 @@
 #include "ast.h"
+#include "walk.h"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace AST {
 
@@ -8,21 +12,547 @@ static const std::string _bin[] = {
     " == ", " != ",  " > ",  " < ",    " >= ",  " <= ", " & ",  " | ",
     "-",    "(not ", "int(", "float(", "bool(", "str(", "len(", " + ["};
 
-//! Saves the current indentation status.
-static int spaces;
-
 //! Takes a single line of code and indents it with two spaces.
 #define _tab(X)                                                                \
-  spaces += 4;                                                                 \
+  output->spaces += 4;                                                         \
   (X);                                                                         \
-  spaces -= 4
+  output->spaces -= 4
 
 //! Variadic macro that prevents indentation for any number of lines.
 #define _notab(...)                                                            \
-  int tmp = spaces;                                                            \
-  spaces = 0;                                                                  \
+  int tmp = output->spaces;                                                    \
+  output->spaces = 0;                                                          \
   (__VA_ARGS__);                                                               \
-  spaces = tmp;
+  output->spaces = tmp;
+
+namespace {
+
+/* Program being written, whose variables are resolved before anything
+   is printed, so that the Python code needs no scopes of its own. */
+struct Module {
+  //! Name of every variable declared inside a nested block or hiding one
+  //! of the functions around it; the others keep their own.
+  std::unordered_map<const VariableNode *, std::string> names;
+
+  //! Function that declares each variable, null for the program.
+  std::unordered_map<const VariableNode *, const FuncNode *> owners;
+
+  //! Variables of the functions around it that each function assigns.
+  std::unordered_map<const FuncNode *, std::vector<std::string>> nonlocals;
+
+  //! Functors that never made it into the tree, by the line calling them.
+  std::unordered_map<const Node *, std::vector<FuncNode *>> orphans;
+  std::unordered_set<const FuncNode *> seen;
+
+  //! Number of variables in scope by name, and the names declared on
+  //! the blocks still open.
+  std::unordered_map<Name, int> visible;
+  std::vector<Name> declared;
+
+  //! Functions met on the blocks still open, scanned when they close.
+  std::vector<FuncNode *> pending;
+
+  //! Blocks met so far, the current one and the line being scanned.
+  int blocks = 0, block = 0;
+  const Node *line = nullptr;
+
+  //! Combination of `PythonFeature` values being written.
+  int features = 0;
+
+  //! Variables that functions other than their own assign.
+  std::unordered_set<const VariableNode *> shared;
+
+  //! Reads of each variable outside of the loops counting on it, which
+  //! are those that may see the value a loop leaves it with.
+  std::unordered_map<const VariableNode *, int> reads;
+  std::vector<const VariableNode *> counters;
+
+  //! Whether any functor is a fold, and whether any array of numbers
+  //! or booleans is made.
+  bool folds = false, arrays = false;
+
+  //! Whether no item of an array of characters is ever assigned, so that
+  //! strings can hold them all.
+  bool strings = true;
+};
+
+/* Loop counting a variable by a constant step up to a bound. */
+struct Range {
+  VariableNode *counter;
+  Node *from, *bound;
+  int step;
+  bool inclusive;
+};
+
+/* Variables written by a piece of code, and whether it calls anything. */
+struct Writes {
+  std::unordered_set<const VariableNode *> vars;
+  bool calls = false;
+};
+
+thread_local Module *_module;
+
+} // namespace
+
+/* Python zero of each base type. */
+static const char *const _zero[] = {"0", "0.0", "False", "'\\0'"};
+
+/* Type code of `array.array` for each base type but characters; items
+   are as wide as those of the bytecode machine. */
+static const char *const _codes[] = {"q", "d", "b"};
+
+/* Keywords of Python and builtins that the code calls, which names of
+   the program must not take. */
+static const std::unordered_set<std::string> _reserved = {
+    "False",    "None",     "True",     "and",      "as",       "assert",
+    "async",    "await",    "break",    "class",    "continue", "def",
+    "del",      "elif",     "else",     "except",   "finally",  "for",
+    "from",     "global",   "if",       "import",   "in",       "is",
+    "lambda",   "nonlocal", "not",      "or",       "pass",     "raise",
+    "return",   "try",      "while",    "with",     "yield",    "bool",
+    "filter",   "float",    "int",      "len",      "list",     "map",
+    "max",      "min",      "range",    "str"};
+
+/* Name of the program that Python can take. */
+static std::string _safe(const std::string &id) {
+  return (_reserved.count(id) != 0) ? id + "_" : id;
+}
+
+/* Python name of a variable. */
+static const std::string &_name(const VariableNode *v) {
+  auto i = _module->names.find(v);
+  return (i != _module->names.end()) ? i->second : *v->id;
+}
+
+/* Brings a variable into scope. */
+static void _declare(VariableNode *v, const FuncNode *f) {
+  _module->owners[v] = f;
+  ++_module->visible[v->id];
+  _module->declared.push_back(v->id);
+}
+
+static void _scan(Node *n, const FuncNode *f, int depth);
+
+/* Step of a walk that scans a child. */
+static Walk::Step _visit(Node *n, const FuncNode *f, int depth) {
+  return {[](const Walk::Step &t) {
+            _scan(t.node, static_cast<const FuncNode *>(t.object), t.a);
+          },
+          n, true, nullptr, const_cast<FuncNode *>(f), depth};
+}
+
+/* Queues a function the first time it is met. */
+static bool _meet(FuncNode *fn) {
+  Module &m = *_module;
+  if (!m.seen.insert(fn).second) {
+    return false;
+  }
+  m.pending.push_back(fn);
+  m.folds = m.folds || FoldFuncNode::classof(fn);
+  m.arrays = m.arrays || !FoldFuncNode::classof(fn);
+  return true;
+}
+
+/* Scans the body of a function, with its parameters in scope; loops
+   around its definition do not count for its reads. */
+static void _define(FuncNode *fn) {
+  Module &m = *_module;
+  if (fn->contents == nullptr) {
+    return;
+  }
+  std::size_t mark = m.declared.size();
+  std::vector<const VariableNode *> counters;
+  counters.swap(m.counters);
+  for (VariableNode *p : fn->createDeque()) {
+    if (_reserved.count(*p->id) != 0) {
+      m.names[p] = _safe(*p->id);
+    }
+    _declare(p, fn);
+  }
+  _scan(fn->contents, fn, 0);
+  for (std::size_t i = mark; i < m.declared.size(); ++i) {
+    --m.visible[m.declared[i]];
+  }
+  m.declared.resize(mark);
+  m.counters.swap(counters);
+}
+
+/* Finds the variables of a subtree, as seen from function `f` (null for
+   the program); `depth` counts the blocks open inside that function.
+   Bodies of functions are scanned once the block defining them closes,
+   so that they see every variable that Python lets them reach. */
+static void _scan(Node *n, const FuncNode *f, int depth) {
+  Module &m = *_module;
+  if (n == nullptr) {
+    return;
+  }
+  switch (n->kind) {
+  case BINARY_OP_NODE: {
+    auto *b = static_cast<BinaryOpNode *>(n);
+    auto *r = node_cast<VarRefNode>(b->left);
+    bool writes = (b->binOp == assign || b->binOp == append);
+    auto o = (r != nullptr) ? m.owners.find(r->decl) : m.owners.end();
+    if (writes && o != m.owners.end() && o->second != f) {
+      // assigning a variable of another function needs it declared
+      std::vector<std::string> &names = m.nonlocals[f];
+      const std::string &name = _name(r->decl);
+      if (std::find(names.begin(), names.end(), name) == names.end()) {
+        names.push_back(name);
+      }
+      m.shared.insert(r->decl);
+    }
+    auto *i = node_cast<BinaryOpNode>(b->left);
+    if (b->binOp == assign && i != nullptr && i->binOp == index &&
+        i->left->_type() % 4 == CHAR) {
+      m.strings = false;
+    }
+    if (b->binOp != assign || r == nullptr) {
+      Walk::run(b, {_visit(b->left, f, depth), _visit(b->right, f, depth)});
+    } else {
+      Walk::run(b, {_visit(b->right, f, depth)});
+    }
+    break;
+  }
+  case UNARY_OP_NODE:
+    Walk::run(n, {_visit(static_cast<UnaryOpNode *>(n)->node, f, depth)});
+    break;
+  case VAR_REF_NODE: {
+    VariableNode *v = static_cast<VarRefNode *>(n)->decl;
+    if (std::find(m.counters.begin(), m.counters.end(), v) ==
+        m.counters.end()) {
+      ++m.reads[v];
+    }
+    break;
+  }
+  case BLOCK_NODE: {
+    std::size_t mark = m.declared.size(), pending = m.pending.size();
+    int block = m.block;
+    const Node *line = m.line;
+    m.block = ++m.blocks;
+    for (Node *l : *static_cast<BlockNode *>(n)) {
+      m.line = l;
+      _scan(l, f, depth + 1);
+    }
+    while (m.pending.size() > pending) {
+      FuncNode *fn = m.pending.back();
+      m.pending.pop_back();
+      _define(fn);
+    }
+    for (std::size_t i = mark; i < m.declared.size(); ++i) {
+      --m.visible[m.declared[i]];
+    }
+    m.declared.resize(mark);
+    m.block = block;
+    m.line = line;
+    break;
+  }
+  case IF_NODE:
+    _scan(static_cast<IfNode *>(n)->condition, f, depth);
+    _scan(static_cast<IfNode *>(n)->_then, f, depth);
+    _scan(static_cast<IfNode *>(n)->_else, f, depth);
+    break;
+  case FOR_NODE: {
+    auto *l = static_cast<ForNode *>(n);
+    auto *a = node_cast<BinaryOpNode>(l->assign);
+    auto *r = (a != nullptr) ? node_cast<VarRefNode>(a->left) : nullptr;
+    _scan(l->assign, f, depth);
+    if (r != nullptr) {
+      m.counters.push_back(r->decl);
+    }
+    _scan(l->test, f, depth);
+    _scan(l->iteration, f, depth);
+    _scan(l->body, f, depth);
+    if (r != nullptr) {
+      m.counters.pop_back();
+    }
+    break;
+  }
+  case FUNC_CALL_NODE: {
+    // functors on the first line of a block never make it into the
+    // tree, and are defined right before the line calling them
+    auto *c = static_cast<FuncCallNode *>(n);
+    if (_meet(c->function)) {
+      m.orphans[m.line].push_back(c->function);
+    }
+    _scan(c->params, f, depth);
+    break;
+  }
+  case MESSAGE_NODE:
+    for (Node *d : static_cast<MessageNode *>(n)->line()) {
+      _scan(d, f, depth);
+    }
+    break;
+  case RETURN_NODE:
+    _scan(static_cast<ReturnNode *>(n)->next, f, depth);
+    break;
+  case DECLARATION_NODE: {
+    auto *d = static_cast<DeclarationNode *>(n);
+    if (depth > 1 || (f != nullptr && m.visible[d->id] > 0)) {
+      m.names[d] = _safe(*d->id) + "__s" + std::to_string(m.block);
+    } else if (_reserved.count(*d->id) != 0) {
+      m.names[d] = _safe(*d->id);
+    }
+    _declare(d, f);
+    m.arrays = m.arrays || (!notArray(d) && d->_type() % 4 != CHAR);
+    break;
+  }
+  case FUNC_NODE:
+  case HI_ORD_FUNC_NODE:
+  case MAP_FUNC_NODE:
+  case FOLD_FUNC_NODE:
+  case FILTER_FUNC_NODE:
+    _meet(static_cast<FuncNode *>(n));
+    break;
+  default:
+    break;
+  }
+}
+
+/* Finds the variables that a piece of code writes, keeping the nodes
+   left to look at on a stack of its own. */
+static void _writes(Node *root, Writes &w) {
+  std::vector<Node *> stack = {root};
+  while (!stack.empty()) {
+    Node *n = stack.back();
+    stack.pop_back();
+    if (n == nullptr) {
+      continue;
+    }
+    switch (n->kind) {
+    case BINARY_OP_NODE: {
+      auto *b = static_cast<BinaryOpNode *>(n);
+      if (b->binOp == assign || b->binOp == append) {
+        Node *target = b->left;
+        auto *i = node_cast<BinaryOpNode>(target);
+        auto *u = node_cast<UnaryOpNode>(target);
+        if (i != nullptr && i->binOp == index) {
+          target = i->left;
+        } else if (u != nullptr && u->op == ref) {
+          target = u->node;
+        }
+        if (VarRefNode::classof(target)) {
+          w.vars.insert(static_cast<VarRefNode *>(target)->decl);
+        }
+      }
+      stack.push_back(b->left);
+      stack.push_back(b->right);
+      break;
+    }
+    case UNARY_OP_NODE:
+      stack.push_back(static_cast<UnaryOpNode *>(n)->node);
+      break;
+    case BLOCK_NODE:
+      for (Node *l : *static_cast<BlockNode *>(n)) {
+        stack.push_back(l);
+      }
+      break;
+    case IF_NODE:
+      stack.push_back(static_cast<IfNode *>(n)->condition);
+      stack.push_back(static_cast<IfNode *>(n)->_then);
+      stack.push_back(static_cast<IfNode *>(n)->_else);
+      break;
+    case FOR_NODE:
+      stack.push_back(static_cast<ForNode *>(n)->assign);
+      stack.push_back(static_cast<ForNode *>(n)->test);
+      stack.push_back(static_cast<ForNode *>(n)->iteration);
+      stack.push_back(static_cast<ForNode *>(n)->body);
+      break;
+    case FUNC_CALL_NODE:
+      w.calls = true;
+      stack.push_back(static_cast<FuncCallNode *>(n)->params);
+      break;
+    case MESSAGE_NODE:
+      for (Node *d : static_cast<MessageNode *>(n)->line()) {
+        stack.push_back(d);
+      }
+      break;
+    case RETURN_NODE:
+      stack.push_back(static_cast<ReturnNode *>(n)->next);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+/* Whether an expression has the same value all along a loop whose body
+   writes `w`. A call may write the variables that other functions
+   assign, or grow any array. */
+static bool _invariant(Node *root, const Writes &w) {
+  std::vector<Node *> stack = {root};
+  while (!stack.empty()) {
+    Node *n = stack.back();
+    stack.pop_back();
+    switch (n->kind) {
+    case INT_NODE:
+    case FLOAT_NODE:
+    case BOOL_NODE:
+    case CHAR_NODE:
+      break;
+    case VAR_REF_NODE: {
+      VariableNode *v = static_cast<VarRefNode *>(n)->decl;
+      if (w.vars.count(v) != 0 ||
+          (w.calls && (_module->shared.count(v) != 0 || !notArray(v)))) {
+        return false;
+      }
+      break;
+    }
+    case BINARY_OP_NODE: {
+      auto *b = static_cast<BinaryOpNode *>(n);
+      if (b->binOp == assign || b->binOp == append) {
+        return false;
+      }
+      stack.push_back(b->left);
+      stack.push_back(b->right);
+      break;
+    }
+    case UNARY_OP_NODE:
+      stack.push_back(static_cast<UnaryOpNode *>(n)->node);
+      break;
+    default:
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Whether the value a loop leaves on its counter may be seen: it is read
+   outside of the loops counting on it, or it is a variable of the
+   program, which outlives it. */
+static bool _kept(const VariableNode *counter) {
+  auto o = _module->owners.find(counter);
+  return _module->reads[counter] > 0 ||
+         (o != _module->owners.end() && o->second == nullptr);
+}
+
+/* Whether a loop counts an integer by a constant step up (or down) to a
+   bound that its body leaves alone, so that it runs as a `range`. The
+   counter must then be left as the loop would leave it, if that is
+   kept; only steps of one make that simple. */
+static bool _range(ForNode *l, Range &r) {
+  auto *a = node_cast<BinaryOpNode>(l->assign);
+  auto *t = node_cast<BinaryOpNode>(l->test);
+  auto *s = node_cast<BinaryOpNode>(l->iteration);
+  if (a == nullptr || t == nullptr || s == nullptr || a->binOp != assign ||
+      s->binOp != assign) {
+    return false;
+  }
+  auto *v = node_cast<VarRefNode>(a->left);
+  auto *sum = node_cast<BinaryOpNode>(s->right);
+  if (v == nullptr || sum == nullptr || v->decl->_type() != INT) {
+    return false;
+  }
+  auto *tv = node_cast<VarRefNode>(t->left);
+  auto *sv = node_cast<VarRefNode>(s->left);
+  auto *pv = node_cast<VarRefNode>(sum->left);
+  auto *k = node_cast<IntNode>(sum->right);
+  if (tv == nullptr || sv == nullptr || pv == nullptr || k == nullptr ||
+      tv->decl != v->decl || sv->decl != v->decl || pv->decl != v->decl ||
+      k->value <= 0) {
+    return false;
+  }
+
+  bool up = (sum->binOp == add && (t->binOp == lt || t->binOp == leq));
+  bool down = (sum->binOp == sub && (t->binOp == gt || t->binOp == geq));
+  if (!(up || down) || a->right->_type() != INT ||
+      t->right->_type() != INT) {
+    return false;
+  }
+  if (k->value != 1 && _kept(v->decl)) {
+    return false;
+  }
+
+  Writes w;
+  _writes(l->body, w);
+  if (w.vars.count(v->decl) != 0 ||
+      (w.calls && _module->shared.count(v->decl) != 0) ||
+      !_invariant(a->right, w) || !_invariant(t->right, w)) {
+    return false;
+  }
+  r = {v->decl, a->right, t->right, up ? k->value : -k->value,
+       t->binOp == leq || t->binOp == geq};
+  return true;
+}
+
+/* Prints where a range stops, one past an inclusive bound. */
+static void _stop(const Range &r) {
+  int past = !r.inclusive ? 0 : (r.step > 0) ? 1 : -1;
+  auto *n = node_cast<IntNode>(r.bound);
+  if (n != nullptr) {
+    text(std::to_string(n->value + past), 0);
+  } else {
+    r.bound->printPython();
+    if (past != 0) {
+      text((past > 0) ? " + 1" : " - 1", 0);
+    }
+  }
+}
+
+/* Array of `n` zeros of a certain array type. */
+static std::string _zeros(int type, const std::string &n) {
+  type = (type < 0) ? INT : type % 4;
+  if (!(_module->features & python_arrays) ||
+      (type == CHAR && !_module->strings)) {
+    return "[" + std::string(_zero[type]) + "] * " + n;
+  }
+  if (type == CHAR) {
+    return "'\\0' * " + n;
+  }
+  return "_array('" + std::string(_codes[type]) + "', [0]) * " + n;
+}
+
+/* Array of a certain type holding the items of an iterator. */
+static std::string _collect(int type, const std::string &items) {
+  type = (type < 0) ? INT : type % 4;
+  if (!(_module->features & python_arrays) ||
+      (type == CHAR && !_module->strings)) {
+    return "list(" + items + ")";
+  }
+  if (type == CHAR) {
+    return "''.join(" + items + ")";
+  }
+  return "_array('" + std::string(_codes[type]) + "', " + items + ")";
+}
+
+/* Python name of a function; lambda is a reserved word in Python. */
+static std::string _callee(const FuncNode *f) {
+  return (*f->id == "lambda") ? "λ" : _safe(*f->id);
+}
+
+/* Prints a line of code, with its own indentation; blocks nested as
+   lines indent each of theirs. */
+static void _line(Node *n) {
+  if (BlockNode::classof(n)) {
+    n->printPython();
+    return;
+  }
+  text("", output->spaces);
+  n->printPython();
+  if (n->_type() != ND) {
+    text("\n", 0);
+  }
+}
+
+/* Prints the body of a compound statement, which Python wants non-empty. */
+static void _body(BlockNode *b) {
+  if (b->empty()) {
+    text("pass\n", output->spaces);
+  } else {
+    b->printPython();
+  }
+}
+
+/* Step of a walk that writes some text, then a child as Python if there
+   is one. */
+static Walk::Step _python(const char *s, Node *n = nullptr) {
+  return {[](const Walk::Step &t) {
+            text(t.text, 0);
+            if (t.node != nullptr) {
+              t.node->printPython();
+            }
+          },
+          n, true, s};
+}
 
 void IntNode::printPython() { text(value, 0); }
 
@@ -33,107 +563,178 @@ void BoolNode::printPython() { text(value ? "True" : "False", 0); }
 void CharNode::printPython() { text(value, 0); }
 
 void BinaryOpNode::printPython() {
-  bool specialOp = (binOp == assign || binOp == index || binOp == append);
-  // all usual binary operations have parenthesis between them
-  if (!specialOp) {
-    text("(", 0);
-  }
-  left->printPython();
-  if (binOp != index) {
-    text(_bin[binOp], 0), right->printPython();
-  } else {
-    text("[", 0);
-    right->printPython();
-    text("]", 0);
-  }
-  if (!specialOp) {
-    text(")", 0);
-  }
   if (binOp == append) {
-    text("]", 0);
+    // arrays of characters are strings, which cannot grow in place, and
+    // typed arrays cannot be joined to lists
+    bool word = (left->_type() % 4 == CHAR);
+    if ((_module->features & (python_idioms | python_arrays)) && !word) {
+      Walk::run(this, {_python("", left), _python(".append(", right),
+                       _python(")")});
+    } else {
+      Walk::run(this, {_python("", left), _python(" = ", left),
+                       _python(word ? " + " : _bin[binOp].c_str(), right),
+                       _python(word ? "" : "]")});
+    }
+    return;
   }
+
+  bool specialOp = (binOp == assign || binOp == index);
+  // all usual binary operations have parenthesis between them
+  const char *close = (binOp == index) ? "]" : specialOp ? "" : ")";
+  Walk::run(this, {_python(specialOp ? "" : "(", left),
+                   _python((binOp == index) ? "[" : _bin[binOp].c_str(), right),
+                   _python(close)});
 }
 
 void UnaryOpNode::printPython() {
-  text(_bin[op], 0);
-  node->printPython();
-  if (op > 16) {
-    // all operations after unary minus
-    text(")", 0);
-  }
+  // all operations after unary minus are closed
+  Walk::run(this,
+            {_python(_bin[op].c_str(), node), _python((op > 16) ? ")" : "")});
 }
 
-void VariableNode::printPython() { text(id, 0); }
+void VariableNode::printPython() { text(_name(this), 0); }
+
+void VarRefNode::printPython() { text(_name(decl), 0); }
 
 void BlockNode::printPython() {
-  for (Node *n : nodeList) {
-    if (n != nullptr) {
-      text("", spaces);
-      n->printPython();
-      if (n->_type() != ND) {
-        text("\n", 0);
+  for (Node *n : *this) {
+    auto o = _module->orphans.find(n);
+    if (o != _module->orphans.end()) {
+      for (FuncNode *f : o->second) {
+        _line(f);
       }
     }
+    _line(n);
   }
 }
 
-void MessageNode::printPython() { next->printPython(); }
+void MessageNode::printPython() {
+  bool first = true;
+  for (Node *d : line()) {
+    if (!first) {
+      text("\n", 0);
+      text("", output->spaces);
+    }
+    d->printPython();
+    first = false;
+  }
+}
 
 void IfNode::printPython() {
-  text("s_context()\n", 0);
-  text("if ", spaces);
+  text("if ", 0);
   _notab(condition->printPython());
   text(":\n", 0);
-  _tab(_then->printPython());
-  if (!_else->nodeList.empty()) {
-    text("else:\n", spaces);
-    _tab(_else->printPython());
+  _tab(_body(_then));
+  if (!_else->empty()) {
+    text("else:\n", output->spaces);
+    _tab(_body(_else));
   }
-  text("r_context()\n", spaces);
 }
 
 void ForNode::printPython() {
-  text("s_context()\n", 0);
+  Range r;
+  if ((_module->features & python_idioms) && _range(this, r)) {
+    auto *from = node_cast<IntNode>(r.from);
+    text("for " + _name(r.counter) + " in range(", 0);
+    if (from == nullptr || from->value != 0 || r.step != 1) {
+      r.from->printPython();
+      text(", ", 0);
+    }
+    _stop(r);
+    text((r.step != 1) ? ", " + std::to_string(r.step) + "):\n" : "):\n", 0);
+    _tab(_body(body));
+    if (_kept(r.counter)) {
+      // the counter stops where the test first fails, if it ever holds
+      auto *to = node_cast<IntNode>(r.bound);
+      text(_name(r.counter) + " = ", output->spaces);
+      if (from != nullptr && to != nullptr) {
+        int past = !r.inclusive ? 0 : r.step;
+        int end = (r.step > 0) ? std::max(from->value, to->value + past)
+                               : std::min(from->value, to->value + past);
+        text(std::to_string(end), 0);
+      } else {
+        text((r.step > 0) ? "max(" : "min(", 0);
+        r.from->printPython();
+        text(", ", 0);
+        _stop(r);
+        text(")", 0);
+      }
+      text("\n", 0);
+    }
+    return;
+  }
+
   if (assign->_type() != ND) {
-    text("", spaces);
     assign->printPython();
     text("\n", 0);
+    text("", output->spaces);
   }
   // transform for in while because there is no C-style for loop in Python
-  text("while ", spaces);
+  text("while ", 0);
   _notab(test->printPython(), text(":\n", 0));
-  _tab(body->printPython());
   if (iteration->_type() != ND) {
-    text("", spaces + 4);
+    _tab(body->printPython());
+    text("", output->spaces + 4);
     iteration->printPython();
     text("\n", 0);
+  } else {
+    _tab(_body(body));
   }
-  text("r_context()\n", spaces);
 }
 
 void FuncNode::printPython() {
-  // lambda is a reserved word in Python
-  text("def " + ((this->id == "lambda") ? "λ" : this->id) + "(", 0);
-  if (params != nullptr) {
-    params->printPython();
+  text("def " + _callee(this) + "(", 0);
+  const char *comma = "";
+  for (VariableNode *p : createDeque()) {
+    if (p->_type() != ND) {
+      text(comma, 0);
+      p->printPython();
+      comma = ", ";
+    }
   }
   text("):\n", 0);
-  if (this->contents != nullptr) {
+  FuncNode *lambda = nullptr;
+  if (HiOrdFuncNode::classof(this) && contents != nullptr) {
+    lambda = node_cast<FuncNode>(contents->front());
+  }
+  if ((_module->features & python_idioms) && lambda != nullptr) {
+    // functors run over the builtins instead of their desugared loops
+    auto *array = static_cast<VariableNode *>(params);
+    std::string f = _callee(lambda), a = *array->id;
+    _tab(_line(lambda));
+    if (MapFuncNode::classof(this)) {
+      // the result is as long as the array was declared, padded by zeros
+      int t = array->_type();
+      text("return " + _collect(t, "map(" + f + ", " + a + ")"),
+           output->spaces + 4);
+      if (array->size > 0) {
+        std::string n = std::to_string(array->size);
+        text(" + " + _zeros(t, "(" + n + " - len(" + a + "))"), 0);
+      }
+    } else if (FoldFuncNode::classof(this)) {
+      text("return _reduce(lambda v, x: v + " + f + "(v, x), " + a + ")",
+           output->spaces + 4);
+    } else {
+      text("return " + _collect(array->_type(), "filter(" + f + ", " + a + ")"),
+           output->spaces + 4);
+    }
+    text("\n", 0);
+  } else if (this->contents != nullptr) {
+    auto n = _module->nonlocals.find(this);
+    if (n != _module->nonlocals.end()) {
+      std::string names;
+      for (const std::string &name : n->second) {
+        names += (names.empty() ? "" : ", ") + name;
+      }
+      text("nonlocal " + names + "\n", output->spaces + 4);
+    }
     _tab(contents->printPython());
   } else {
-    text("pass", spaces);
+    text("pass", output->spaces + 4);
   }
 }
 
-void ParamNode::printPython() {
-  if (this->_type() != ND) {
-    if (next != nullptr) {
-      next->printPython();
-      text(", ", 0);
-    }
-    text(id, 0);
-  }
-}
+void ParamNode::printPython() { text(_name(this), 0); }
 
 void ReturnNode::printPython() {
   text("return ", 0);
@@ -141,28 +742,50 @@ void ReturnNode::printPython() {
 }
 
 void FuncCallNode::printPython() {
-  text(((function->id == "lambda") ? "λ" : function->id) + "(", 0);
-  for (Node *n : params->nodeList) {
-    n->printPython();
-    if (n != params->nodeList.back()) {
-      text(", ", 0);
-    }
+  text(_callee(function) + "(", 0);
+  std::vector<Walk::Step> steps;
+  for (Node *n : *params) {
+    steps.push_back(_python(steps.empty() ? "" : ", ", n));
   }
-  text(")", 0);
+  steps.push_back(_python(")"));
+  Walk::run(this, steps);
 }
 
 void DeclarationNode::printPython() {
-  if (next != nullptr) {
-    next->printPython();
-    text("\n", 0);
-    text("", spaces);
-  }
-  // do not print node if it is not initialized
+  // every variable is bound, so that nested functions may assign it
+  std::string zero = _zero[(type < 0) ? INT : type % 4];
   if (this->init) {
-    text(id, 0);
-  } else if (!notArray(this)) {
-    text(id + " = [0] * " + std::to_string(this->size), 0);
+    text(_name(this), 0);
+  } else if (notArray(this)) {
+    text(_name(this) + " = " + zero, 0);
+  } else {
+    text(_name(this) + " = " + _zeros(type, std::to_string(size)), 0);
+  }
+}
+
+void emitPython(BlockNode *root, int features) {
+  Module module, *outer = _module;
+  _module = &module;
+  module.features = features;
+  _scan(root, nullptr, 0);
+
+  // names of the language start with a letter, and cannot hide these
+  bool arrays = (features & python_arrays) && module.arrays;
+  bool folds = (features & python_idioms) && module.folds;
+  if (arrays) {
+    text("from array import array as _array\n", 0);
+  }
+  if (folds) {
+    text("from functools import reduce as _reduce\n", 0);
+  }
+  if (arrays || folds) {
+    text("\n\n", 0);
   }
+  // locals of a function are faster in Python than globals of a module
+  text("def main():\n", 0);
+  _tab(_body(root));
+  text("\n\nmain()\n", 0);
+  _module = outer;
 }
 
 } // namespace AST
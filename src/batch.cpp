@@ -0,0 +1,141 @@
+#include "batch.h"
+#include "compiler.h"
+#include "pool.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Creates every missing directory that leads to `path`. */
+static void _mkdirs(const std::string &path) {
+  for (std::size_t i = path.find('/', 1); i != std::string::npos;
+       i = path.find('/', i + 1)) {
+    mkdir(path.substr(0, i).c_str(), 0777);
+  }
+}
+
+bool Batch::manifest(const char *path) {
+  std::ifstream in(path);
+  if (!in) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty()) {
+      files.push_back(line);
+    }
+  }
+  return true;
+}
+
+std::string Batch::destination(const std::string &path) const {
+  // the source tree is mirrored under the output directory,
+  // so that files with the same name do not clash
+  std::size_t start = path.find_first_not_of('/');
+  std::string name = path.substr(start == std::string::npos ? 0 : start);
+  std::size_t dot = name.rfind('.');
+  if (dot != std::string::npos && name.find('/', dot) == std::string::npos) {
+    name.erase(dot);
+  }
+  static const char *const extensions[] = {".out", ".py", ".c", ".pyc"};
+  return std::string(outdir) + "/" + name + extensions[target];
+}
+
+void Batch::compile(std::size_t i) {
+  Result &r = results[i];
+  const std::string &path = files[i];
+
+  FILE *in = std::fopen(path.c_str(), "r");
+  if (in == nullptr) {
+    r.diagnostics = path + ": " + std::strerror(errno) + "\n";
+    r.failed = true;
+    return;
+  }
+
+  int fd = -1;
+  if (outdir != nullptr) {
+    std::string name = destination(path);
+    _mkdirs(name);
+    fd = open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+      r.diagnostics = name + ": " + std::strerror(errno) + "\n";
+      r.failed = true;
+      std::fclose(in);
+      return;
+    }
+  }
+
+  char *text = nullptr;
+  std::size_t length = 0;
+  FILE *diagnostics = open_memstream(&text, &length);
+  {
+    std::unique_ptr<AST::Writer> out(fd < 0 ? new AST::Writer(&r.code)
+                                            : new AST::Writer(fd));
+    Compiler c(*out);
+    c.source = path.c_str();
+    c.diagnostics = diagnostics;
+    c.python = python;
+    c.optimize = optimize;
+    c.stats = (stats != nullptr) ? &r.stats : nullptr;
+    c.streaming = streaming;
+    c.parse(in);
+    c.emit(target);
+    r.lines = c.line() - 1;
+    r.failed = (c.errors > 0);
+  }
+  std::fclose(diagnostics);
+  r.diagnostics.assign(text, length);
+  std::free(text);
+
+  if (fd >= 0) {
+    close(fd);
+  }
+  std::fclose(in);
+}
+
+int Batch::run() {
+  auto start = std::chrono::steady_clock::now();
+  results.assign(files.size(), Result());
+
+  // results are written in the order of the list as soon as
+  // every file before them is done, not when the batch ends
+  AST::Writer out(STDOUT_FILENO);
+  std::mutex lock;
+  std::size_t written = 0, lines = 0;
+  int failures = 0;
+
+  Pool(jobs).run(files.size(), [&](std::size_t i) {
+    compile(i);
+    std::lock_guard<std::mutex> guard(lock);
+    results[i].done = true;
+    for (; written < results.size() && results[written].done; ++written) {
+      Result &r = results[written];
+      out.write(r.code);
+      out.flush();
+      std::fputs(r.diagnostics.c_str(), stderr);
+      lines += r.lines;
+      failures += r.failed;
+      if (stats != nullptr) {
+        stats->add(r.stats);
+      }
+      std::string().swap(r.code);
+      std::string().swap(r.diagnostics);
+    }
+  });
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  double seconds = elapsed.count() > 0 ? elapsed.count() : 1e-9;
+  std::fprintf(stderr,
+               "%zu files, %zu lines in %.3f s (%.0f files/s, %.0f lines/s)\n",
+               files.size(), lines, elapsed.count(), files.size() / seconds,
+               lines / seconds);
+
+  return failures;
+}
@@ -0,0 +1,281 @@
+#include "compiler.h"
+#include "parser.h"
+#include "pyc.h"
+#include "vm.h"
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+thread_local Compiler *compiler;
+thread_local AST::Arena *arena;
+thread_local AST::Writer *output;
+
+Compiler::Bind::Bind(Compiler *bound)
+    : c(compiler), a(::arena), i(::names), o(::output) {
+  // previous bindings are saved, so that a compilation may be
+  // bound again while it is already running on this thread
+  compiler = bound;
+  ::arena = &bound->arena;
+  ::names = &bound->names;
+  ::output = &bound->output;
+}
+
+Compiler::Bind::~Bind() {
+  compiler = c;
+  ::arena = a;
+  ::names = i;
+  ::output = o;
+}
+
+Compiler::Compiler(AST::Writer &output) : output(output) {
+  yylex_init_extra(this, &scanner);
+}
+
+Compiler::~Compiler() {
+  if (stats != nullptr) {
+    stats->gather(arena);
+    stats->names += names.size();
+    std::size_t depth = table.scopes.maxDepth();
+    stats->depth = (depth > stats->depth) ? depth : stats->depth;
+  }
+
+  // the arena is released here rather than by its own destructor, so
+  // that dropping the syntax tree is timed along with the rest
+  Stats::Timer t(stats, Stats::teardown);
+  yylex_destroy(scanner);
+  for (Input &i : inputs) {
+    if (i.mapped) {
+      munmap(i.base, i.length);
+    } else {
+      std::free(i.base);
+    }
+  }
+  arena.release();
+}
+
+Compiler::Input Compiler::load(FILE *in, std::size_t &size) {
+  struct stat st;
+  int fd = fileno(in);
+
+  if (fd >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+    // the file is mapped over an anonymous reservation with room for
+    // two more bytes, which are zero whether they fall on the tail of
+    // the last page of the file or on the reservation itself; pages
+    // are private, since flex writes to its buffer while scanning
+    std::size_t page = sysconf(_SC_PAGESIZE);
+    size = st.st_size;
+    std::size_t length = (size + 2 + page - 1) / page * page;
+    void *base = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base != MAP_FAILED &&
+        (size == 0 || mmap(base, size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED)) {
+      return {static_cast<char *>(base), length, true};
+    }
+    if (base != MAP_FAILED) {
+      munmap(base, length);
+    }
+  }
+
+  // pipes and terminals are read into one buffer that keeps doubling
+  std::size_t length = 1 << 16, r;
+  char *base = static_cast<char *>(std::malloc(length));
+  size = 0;
+  while ((r = std::fread(base + size, 1, length - 2 - size, in)) > 0) {
+    size += r;
+    if (size == length - 2) {
+      length *= 2;
+      base = static_cast<char *>(std::realloc(base, length));
+    }
+  }
+  base[size] = base[size + 1] = '\0';
+  return {base, length, false};
+}
+
+void Compiler::parse(FILE *in) {
+  Bind b(this);
+  std::size_t size;
+  inputs.push_back(load(in, size));
+  scan_buffer(inputs.back().base, size + 2, scanner);
+
+  double nested = 0;
+  if (stats != nullptr) {
+    stats->source += size;
+    nested = stats->seconds[Stats::lexing] + stats->seconds[Stats::checking] +
+             stats->seconds[Stats::emission] + stats->seconds[Stats::teardown];
+  }
+  {
+    Stats::Timer t(stats, Stats::parsing);
+    yyparse(scanner, this);
+  }
+  if (stats != nullptr) {
+    // the parser runs the scanner and the checks, and emits and drops
+    // lines if streaming, all of which are timed on their own
+    stats->seconds[Stats::parsing] -=
+        stats->seconds[Stats::lexing] + stats->seconds[Stats::checking] +
+        stats->seconds[Stats::emission] + stats->seconds[Stats::teardown] -
+        nested;
+  }
+}
+
+void Compiler::stream(AST::BlockNode *lines) {
+  if (!streaming || table.scopes.depth() != 1) {
+    return;
+  }
+
+  // a function declared ahead is written where it is declared, but with
+  // the body of its definition, so every line from there on waits for it
+  for (; checked < lines->size(); ++checked) {
+    auto *f = AST::node_cast<AST::FuncNode>((*lines)[checked]);
+    if (f != nullptr && f->contents == nullptr) {
+      declared.push_back(f);
+    }
+  }
+  while (!declared.empty() && declared.back()->contents != nullptr) {
+    declared.pop_back();
+  }
+  if (!declared.empty()) {
+    return;
+  }
+  checked = 0;
+
+  {
+    Stats::Timer t(stats, Stats::emission);
+    if (optimize && errors == 0) {
+      AST::fold(lines);
+    }
+    lines->printPrefix();
+    lines->clear();
+    tmp_f = nullptr;
+  }
+
+  // the first block holds the whole program and is always kept, as are
+  // lines that define globals, which later lines refer to; what is
+  // dropped is counted first, so the totals match a whole compilation
+  Stats::Timer t(stats, Stats::teardown);
+  if (marked && table.globals == globals) {
+    if (stats != nullptr) {
+      stats->gather(arena, kept);
+    }
+    arena.rewind(kept);
+  } else {
+    kept = arena.mark();
+    marked = true;
+    globals = table.globals;
+  }
+}
+
+void Compiler::emit(Target target) {
+  Bind b(this);
+  Stats::Timer t(stats, Stats::emission);
+  if (root != nullptr) {
+    if (optimize && errors == 0) {
+      AST::fold(root);
+    }
+    if (target == python_code) {
+      AST::emitPython(root, python);
+    } else if (target == pyc_code) {
+      emitPyc();
+    } else if (target == c_code) {
+      AST::emitC(root);
+    } else {
+      root->printPrefix();
+    }
+  }
+  output.flush();
+}
+
+void Compiler::emitPyc() {
+  // the Python text is gathered apart and only its code object is
+  // written, so that nothing reaches the sink if it fails to compile
+  std::string source, pyc, error;
+  {
+    AST::Writer text(&source);
+    ::output = &text;
+    AST::emitPython(root, python);
+    ::output = &output;
+  }
+  if (PYC::compile(source, this->source ? this->source : "<stdin>", pyc,
+                   error)) {
+    output.write(pyc);
+  } else {
+    ++errors;
+    if (this->source != nullptr) {
+      std::fprintf(diagnostics, "%s: ", this->source);
+    }
+    std::fprintf(diagnostics, "pyc: %s\n", error.c_str());
+  }
+}
+
+bool Compiler::execute(bool trace) {
+  Bind b(this);
+  if (errors > 0 || root == nullptr) {
+    return errors == 0;
+  }
+  if (optimize) {
+    AST::fold(root);
+  }
+  VM::Program program;
+  if (VM::Builder(program, diagnostics).build(root) > 0) {
+    return false;
+  }
+  if (trace) {
+    program.disassemble(diagnostics);
+  }
+  VM::Machine machine(program);
+  bool ok = machine.run(diagnostics);
+  if (trace && ok) {
+    machine.dump(diagnostics);
+  }
+  return ok;
+}
+
+int Compiler::line() { return yyget_lineno(scanner); }
+
+AST::View reduce_char(const char *s, int n) {
+  if (n > 3) {
+    char t[4] = {'\'', s[1], '\'', '\0'};
+    yyerror("warning: value truncated to %s", t);
+    return {arena->copy(t, 3), 3};
+  }
+  return {s, std::size_t(n)};
+}
+
+/* Starts a diagnostic at the line being read. */
+static void _locate() {
+  if (compiler->source != nullptr) {
+    std::fprintf(compiler->diagnostics, "%s: ", compiler->source);
+  }
+  std::fprintf(compiler->diagnostics, "[Line %d] ", compiler->line());
+}
+
+/* Bison standard error output function. */
+void yyerror(const char *s, ...) {
+  va_list ap;
+  va_start(ap, s);
+  _locate();
+  if (std::strncmp(s, "warning", 7) != 0) {
+    ++compiler->errors;
+  }
+  std::vfprintf(compiler->diagnostics, s, ap);
+  std::fprintf(compiler->diagnostics, "\n");
+  va_end(ap);
+}
+
+/* Error function called by the reentrant parser. */
+void yyerror(yyscan_t, Compiler *, const char *s) { yyerror("%s", s); }
+
+/* Semantic error function. */
+void yyserror(const char *s, ...) {
+  va_list ap;
+  va_start(ap, s);
+  _locate();
+  ++compiler->errors;
+  std::fprintf(compiler->diagnostics, "semantic error: ");
+  std::vfprintf(compiler->diagnostics, s, ap);
+  std::fprintf(compiler->diagnostics, "\n");
+  va_end(ap);
+}
@@ -0,0 +1,174 @@
+#include "flat.h"
+#include <unordered_map>
+
+namespace AST {
+
+/* Appends the children of a node, in the order the table keeps them. */
+static void _children(Node *n, std::vector<Node *> &out) {
+  switch (n->kind) {
+  case BINARY_OP_NODE:
+    out.push_back(static_cast<BinaryOpNode *>(n)->left);
+    out.push_back(static_cast<BinaryOpNode *>(n)->right);
+    break;
+  case UNARY_OP_NODE:
+    out.push_back(static_cast<UnaryOpNode *>(n)->node);
+    break;
+  case BLOCK_NODE:
+    for (Node *s : *static_cast<BlockNode *>(n)) {
+      out.push_back(s);
+    }
+    break;
+  case IF_NODE: {
+    auto *i = static_cast<IfNode *>(n);
+    out.push_back(i->condition);
+    out.push_back(i->_then);
+    out.push_back(i->_else);
+    break;
+  }
+  case FOR_NODE: {
+    auto *l = static_cast<ForNode *>(n);
+    out.push_back(l->assign);
+    out.push_back(l->test);
+    out.push_back(l->iteration);
+    out.push_back(l->body);
+    break;
+  }
+  case FUNC_CALL_NODE:
+    for (Node *p : *static_cast<FuncCallNode *>(n)->params) {
+      out.push_back(p);
+    }
+    break;
+  case MESSAGE_NODE:
+    for (Node *d : static_cast<MessageNode *>(n)->line()) {
+      out.push_back(d);
+    }
+    break;
+  case RETURN_NODE:
+    out.push_back(static_cast<ReturnNode *>(n)->next);
+    break;
+  default:
+    if (FuncNode::classof(n)) {
+      auto *f = static_cast<FuncNode *>(n);
+      for (VariableNode *p : f->createDeque()) {
+        out.push_back(p);
+      }
+      if (f->contents != nullptr) {
+        out.push_back(f->contents);
+      }
+    }
+    break;
+  }
+}
+
+Flat::Flat(BlockNode *root) {
+  // nodes are numbered as they are met, and each one is taken in turn
+  // to number its children after every node numbered so far
+  std::vector<Node *> nodes = {root}, children;
+  std::unordered_map<const Node *, Index> declared;
+  std::unordered_map<Name, std::uint32_t> kept;
+  std::unordered_map<std::string, std::uint32_t> literals;
+  std::vector<std::pair<Index, const Node *>> uses;
+
+  auto keep = [&](const char *s, std::size_t n) {
+    auto position = static_cast<std::uint32_t>(pool.size());
+    pool.append(s, n);
+    pool.push_back('\0');
+    return position;
+  };
+  // names are interned already, and told apart by their address
+  auto name = [&](Name id) {
+    auto k = kept.find(id);
+    return (k != kept.end()) ? k->second
+                             : (kept[id] = keep(id->data(), id->size()));
+  };
+  auto literal = [&](const View &v) {
+    std::string s = v.str();
+    auto l = literals.find(s);
+    return (l != literals.end()) ? l->second
+                                 : (literals[s] = keep(v.data, v.size));
+  };
+
+  first.push_back(1);
+  for (Index i = 0; i < nodes.size(); ++i) {
+    Node *n = nodes[i];
+    children.clear();
+    if (n != nullptr) {
+      _children(n, children);
+    }
+    nodes.insert(nodes.end(), children.begin(), children.end());
+    first.push_back(static_cast<Index>(nodes.size()));
+    if (n == nullptr) {
+      // a child left out of a program with errors
+      kinds.push_back(BASE_NODE);
+      types.push_back(ND);
+      ops.push_back(0);
+      values.push_back(0);
+      sizes.push_back(0);
+      continue;
+    }
+
+    std::uint8_t op = 0;
+    std::uint32_t value = 0, size = 0;
+    switch (n->kind) {
+    case INT_NODE:
+      value = static_cast<std::uint32_t>(static_cast<IntNode *>(n)->value);
+      break;
+    case BOOL_NODE:
+      value = static_cast<BoolNode *>(n)->value;
+      break;
+    case FLOAT_NODE:
+      value = literal(static_cast<FloatNode *>(n)->value);
+      break;
+    case CHAR_NODE:
+      value = literal(static_cast<CharNode *>(n)->value);
+      break;
+    case BINARY_OP_NODE:
+      op = static_cast<BinaryOpNode *>(n)->binOp;
+      break;
+    case UNARY_OP_NODE:
+      op = static_cast<UnaryOpNode *>(n)->op;
+      break;
+    case VAR_REF_NODE:
+      uses.emplace_back(i, static_cast<VarRefNode *>(n)->decl);
+      break;
+    case FUNC_CALL_NODE:
+      uses.emplace_back(i, static_cast<FuncCallNode *>(n)->function);
+      break;
+    default:
+      if (VariableNode::classof(n)) {
+        auto *v = static_cast<VariableNode *>(n);
+        value = name(v->id);
+        size = v->size;
+        declared.emplace(n, i);
+      } else if (FuncNode::classof(n)) {
+        auto *f = static_cast<FuncNode *>(n);
+        value = name(f->id);
+        declared.emplace(n, i);
+      }
+      break;
+    }
+    kinds.push_back(static_cast<std::uint8_t>(n->kind));
+    types.push_back(static_cast<std::int8_t>(n->type));
+    ops.push_back(op);
+    values.push_back(value);
+    sizes.push_back(size);
+  }
+
+  // uses are resolved once every declaration has its position, since
+  // breadth first a use may come before what it refers to
+  for (const auto &u : uses) {
+    auto d = declared.find(u.second);
+    values[u.first] = (d != declared.end()) ? d->second : none;
+  }
+}
+
+std::size_t Flat::bytes() const {
+  return kinds.capacity() * sizeof(kinds[0]) +
+         types.capacity() * sizeof(types[0]) +
+         ops.capacity() * sizeof(ops[0]) +
+         first.capacity() * sizeof(first[0]) +
+         values.capacity() * sizeof(values[0]) +
+         sizes.capacity() * sizeof(sizes[0]) + pool.capacity();
+}
+
+} // namespace AST
@@ -0,0 +1,61 @@
+#include "intern.h"
+#include <cstring>
+
+thread_local AST::Interner *names;
+
+namespace AST {
+
+/* FNV-1a hash of a sequence of characters. */
+static std::uint32_t _hash(const char *s, std::size_t n) {
+  std::uint32_t h = 2166136261U;
+  for (std::size_t i = 0; i < n; ++i) {
+    h = (h ^ static_cast<unsigned char>(s[i])) * 16777619U;
+  }
+  return h;
+}
+
+Name Interner::intern(const char *s, std::size_t n) {
+  std::uint32_t h = _hash(s, n);
+  std::size_t mask = slots.size() - 1;
+
+  for (std::size_t i = h & mask;; i = (i + 1) & mask) {
+    Slot &slot = slots[i];
+    if (slot.name == nullptr) {
+      strings.emplace_back(s, n);
+      slot = {h, &strings.back()};
+      // keep the load factor under one half
+      if (2 * strings.size() > slots.size()) {
+        grow();
+      }
+      return &strings.back();
+    }
+    if (slot.hash == h && slot.name->size() == n &&
+        std::memcmp(slot.name->data(), s, n) == 0) {
+      return slot.name;
+    }
+  }
+}
+
+void Interner::grow() {
+  std::vector<Slot> old(2 * slots.size());
+  old.swap(slots);
+  std::size_t mask = slots.size() - 1;
+
+  for (const Slot &slot : old) {
+    if (slot.name != nullptr) {
+      std::size_t i = slot.hash & mask;
+      while (slots[i].name != nullptr) {
+        i = (i + 1) & mask;
+      }
+      slots[i] = slot;
+    }
+  }
+}
+
+Name intern(const char *s, std::size_t n) { return names->intern(s, n); }
+
+Name intern(const char *s) { return names->intern(s, std::strlen(s)); }
+
+Name intern(const std::string &s) { return names->intern(s.data(), s.size()); }
+
+} // namespace AST
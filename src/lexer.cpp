@@ -0,0 +1,391 @@
+/*
+ * Hand-written scanner for a language called Łukasiewicz, based on
+ * prefix notation. It recognizes exactly the tokens of `scanner.l`,
+ * with the same longest-match rules, behind the same reentrant
+ * interface, and is chosen at build time with `make LEXER=hand`.
+ *
+ * Authors: Douglas Martins, Gustavo Zambonin,
+ *          Marcello Klingelfus
+ */
+#include "compiler.h"
+#include "parser.h"
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+/* What the scanner does upon the first byte of a token. */
+enum ByteClass : unsigned char {
+  SKIP,    // matched alone by the catch-all rule, and ignored
+  SPACE,   // blanks, which are ignored
+  NEWLINE, // end of a line
+  DIGIT,   // start of an integer or of a decimal
+  DOT,     // start of a decimal, if a digit follows
+  ALPHA,   // start of a name, keyword or boolean
+  QUOTE,   // start of a character literal
+  DQUOTE,  // start of a string literal
+  HASH,    // start of a comment
+  BRACKET, // opening bracket, or the start of a cast
+  LAMBDA,  // first byte of `λ`, if the second follows
+  ERROR,   // start of a run of unknown bytes
+  SYMBOL   // operator or delimiter
+};
+
+/* Reserved word, including the boolean literals. */
+struct Keyword {
+  const char *text;
+  std::size_t size;
+  int token;
+
+  //! Whether the parser takes the word itself as the token value.
+  bool named;
+};
+
+/* Lookup tables, filled once before `main`. */
+struct Tables {
+  ByteClass classes[256];
+
+  //! Bytes that may continue a name.
+  bool name[256];
+
+  //! Bytes that may appear between quotes.
+  bool chars[256];
+
+  //! Bytes of the run reported as a lexical error.
+  bool error[256];
+
+  //! Reserved words, placed by a perfect hash.
+  Keyword keywords[32];
+
+  Tables();
+};
+
+/* Perfect hash of the reserved words, found by searching small
+   multipliers of their first and last characters. */
+inline std::size_t _hash(const char *s, std::size_t n) {
+  return (8 * static_cast<unsigned char>(s[0]) +
+          19 * static_cast<unsigned char>(s[n - 1]) + n) &
+         31;
+}
+
+Tables::Tables() {
+  for (int c = 0; c < 256; ++c) {
+    bool printable = (c >= ' ' && c <= '~');
+    name[c] = std::isalnum(c) || c == '_';
+    chars[c] = printable && c != '"' && c != '\'';
+    error[c] = !printable && c != '\t' && c != '\n' && c != 0xCE && c != 0xBB;
+    classes[c] = error[c] ? ERROR : SKIP;
+    if (std::isdigit(c)) {
+      classes[c] = DIGIT;
+    } else if (std::isalpha(c)) {
+      classes[c] = ALPHA;
+    }
+  }
+  for (unsigned char c : std::string("+-*/,=()!<>&|{}]")) {
+    classes[c] = SYMBOL;
+  }
+  classes[static_cast<unsigned char>(' ')] = SPACE;
+  classes[static_cast<unsigned char>('\t')] = SPACE;
+  classes[static_cast<unsigned char>('\n')] = NEWLINE;
+  classes[static_cast<unsigned char>('.')] = DOT;
+  classes[static_cast<unsigned char>('\'')] = QUOTE;
+  classes[static_cast<unsigned char>('"')] = DQUOTE;
+  classes[static_cast<unsigned char>('#')] = HASH;
+  classes[static_cast<unsigned char>('[')] = BRACKET;
+  classes[0xCE] = LAMBDA;
+
+  // the table starts zeroed, as it has static storage
+  static const Keyword words[] = {
+      {"addr", 4, ADDR, false},       {"ref", 3, REF, false},
+      {"int", 3, T_INT, false},       {"float", 5, T_FLOAT, false},
+      {"bool", 4, T_BOOL, false},     {"char", 4, T_CHAR, false},
+      {"if", 2, IF, false},           {"then", 4, THEN, false},
+      {"else", 4, ELSE, false},       {"for", 3, FOR, false},
+      {"fun", 3, FUN, false},         {"ret", 3, RET, false},
+      {"array", 5, ARR, false},       {"map", 3, F_MAP, true},
+      {"fold", 4, F_FOLD, true},      {"filter", 6, F_FILTER, true},
+      {"lambda", 6, F_LAMBDA, true},  {"true", 4, BOOL, false},
+      {"false", 5, BOOL, false}};
+  for (const Keyword &w : words) {
+    keywords[_hash(w.text, w.size)] = w;
+  }
+}
+
+const Tables _tables;
+
+/* Input being scanned. */
+struct Buffer {
+  const char *cursor;
+  const char *end;
+  int line;
+};
+
+/* State of a scanner. */
+struct Scanner {
+  Compiler *extra;
+  Buffer input;
+};
+
+/* Skips blanks, returning the first byte that is not one. */
+inline const char *_blanks(const char *p, const char *end) {
+#ifdef __SSE2__
+  const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+  while (end - p >= 16) {
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    unsigned mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(b, space), _mm_cmpeq_epi8(b, tab)));
+    if (mask != 0xFFFF) {
+      return p + __builtin_ctz(~mask);
+    }
+    p += 16;
+  }
+#endif
+  while (p < end && (*p == ' ' || *p == '\t')) {
+    ++p;
+  }
+  return p;
+}
+
+/* Skips a comment, returning its closing newline or the end. */
+inline const char *_comment(const char *p, const char *end) {
+#ifdef __SSE2__
+  const __m128i newline = _mm_set1_epi8('\n');
+  while (end - p >= 16) {
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(b, newline));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+    p += 16;
+  }
+#endif
+  const void *n = std::memchr(p, '\n', end - p);
+  return (n != nullptr) ? static_cast<const char *>(n) : end;
+}
+
+/* Skips the bytes that satisfy a table. */
+inline const char *_span(const bool *table, const char *p, const char *end) {
+  while (p < end && table[static_cast<unsigned char>(*p)]) {
+    ++p;
+  }
+  return p;
+}
+
+/* Skips decimal digits. */
+inline const char *_digits(const char *p, const char *end) {
+  while (p < end && *p >= '0' && *p <= '9') {
+    ++p;
+  }
+  return p;
+}
+
+/* Recognizes a cast such as `[int]`, returning its length or zero. */
+inline int _cast(const char *p, const char *end, int &token) {
+  static const Keyword casts[] = {{"[int]", 5, C_INT, false},
+                                  {"[float]", 7, C_FLOAT, false},
+                                  {"[bool]", 6, C_BOOL, false},
+                                  {"[word]", 6, C_STR, false},
+                                  {"[len]", 5, LEN, false}};
+  for (const Keyword &c : casts) {
+    if (static_cast<std::size_t>(end - p) >= c.size &&
+        std::memcmp(p, c.text, c.size) == 0) {
+      token = c.token;
+      return c.size;
+    }
+  }
+  return 0;
+}
+
+/* Recognizes an operator or delimiter, advancing past it. */
+inline int _symbol(const char *&p, const char *end) {
+  char c = *p++;
+  char next = (p < end) ? *p : '\0';
+  switch (c) {
+  case '+':
+    return PLUS;
+  case '-':
+    return (next == '>') ? (++p, RET_L) : MINUS;
+  case '*':
+    return TIMES;
+  case '/':
+    return DIV;
+  case ',':
+    return COMMA;
+  case '=':
+    return (next == '=') ? (++p, EQ) : ASSIGN;
+  case '(':
+    return LPAR;
+  case ')':
+    return RPAR;
+  case '!':
+    return (next == '=') ? (++p, NEQ) : NOT;
+  case '>':
+    return (next == '=') ? (++p, GEQ) : GT;
+  case '<':
+    if (next == '=') {
+      ++p;
+      return LEQ;
+    }
+    return (next == '-') ? (++p, APPEND) : LT;
+  case '&':
+    return AND;
+  case '|':
+    return OR;
+  case '{':
+    return LCURLY;
+  case '}':
+    return RCURLY;
+  default:
+    return RBRAC;
+  }
+}
+
+} // namespace
+
+int yylex(YYSTYPE *yylval, yyscan_t scanner) {
+  Scanner *s = static_cast<Scanner *>(scanner);
+  Buffer &b = s->input;
+  const char *p = b.cursor, *end = b.end;
+  const Tables &t = _tables;
+
+  for (;;) {
+    if (p >= end) {
+      b.cursor = p;
+      return 0;
+    }
+
+    const char *start = p;
+    int token;
+    switch (t.classes[static_cast<unsigned char>(*p)]) {
+    case SPACE:
+      p = _blanks(p, end);
+      continue;
+
+    case HASH:
+      p = _comment(p, end);
+      continue;
+
+    case NEWLINE:
+      b.cursor = p + 1;
+      ++b.line;
+      return NL;
+
+    case DIGIT:
+      p = _digits(p, end);
+      if (p < end && *p == '.') {
+        p = _digits(p + 1, end);
+        yylval->view = {start, std::size_t(p - start)};
+        b.cursor = p;
+        return FLOAT;
+      }
+      // the digits are followed by a byte that is not a digit
+      yylval->integer = std::atoi(start);
+      b.cursor = p;
+      return INT;
+
+    case DOT:
+      if (p + 1 < end && p[1] >= '0' && p[1] <= '9') {
+        p = _digits(p + 1, end);
+        yylval->view = {start, std::size_t(p - start)};
+        b.cursor = p;
+        return FLOAT;
+      }
+      ++p;
+      continue;
+
+    case ALPHA: {
+      p = _span(t.name, p + 1, end);
+      std::size_t n = p - start;
+      const Keyword &k = t.keywords[_hash(start, n)];
+      b.cursor = p;
+      if (k.size == n && std::memcmp(k.text, start, n) == 0) {
+        if (k.token == BOOL) {
+          yylval->boolean = (*start == 't');
+        } else if (k.named) {
+          yylval->word = AST::intern(start, n);
+        }
+        return k.token;
+      }
+      yylval->word = AST::intern(start, n);
+      return ID;
+    }
+
+    case QUOTE:
+      p = _span(t.chars, p + 1, end);
+      if (p > start + 1 && p < end && *p == '\'') {
+        b.cursor = ++p;
+        yylval->view = reduce_char(start, p - start);
+        return CHAR;
+      }
+      p = start + 1;
+      continue;
+
+    case DQUOTE:
+      p = _span(t.chars, p + 1, end);
+      if (p < end && *p == '"') {
+        b.cursor = ++p;
+        yylval->view = {start, std::size_t(p - start)};
+        return STR;
+      }
+      p = start + 1;
+      continue;
+
+    case BRACKET:
+      if (int n = _cast(p, end, token)) {
+        b.cursor = p + n;
+        return token;
+      }
+      b.cursor = p + 1;
+      return LBRAC;
+
+    case LAMBDA:
+      if (p + 1 < end && static_cast<unsigned char>(p[1]) == 0xBB) {
+        b.cursor = p + 2;
+        yylval->word = AST::intern(p, 2);
+        return L_CALL;
+      }
+      ++p;
+      continue;
+
+    case ERROR: {
+      p = _span(t.error, p, end);
+      b.cursor = p;
+      std::string text(start, p);
+      yyerror("lexical error: unknown symbol %s", text.c_str());
+      continue;
+    }
+
+    case SYMBOL:
+      token = _symbol(p, end);
+      b.cursor = p;
+      return token;
+
+    case SKIP:
+      ++p;
+      continue;
+    }
+  }
+}
+
+int yylex_init_extra(Compiler *extra, yyscan_t *scanner) {
+  *scanner = new Scanner{extra, {nullptr, nullptr, 0}};
+  return 0;
+}
+
+int yylex_destroy(yyscan_t scanner) {
+  delete static_cast<Scanner *>(scanner);
+  return 0;
+}
+
+int yyget_lineno(yyscan_t scanner) {
+  return static_cast<Scanner *>(scanner)->input.line;
+}
+
+void scan_buffer(char *base, std::size_t size, yyscan_t scanner) {
+  static_cast<Scanner *>(scanner)->input = {base, base + size - 2, 1};
+}
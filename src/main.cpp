@@ -0,0 +1,195 @@
+/*
+ * Command line driver of the compiler for a language called
+ * Łukasiewicz, based on prefix notation.
+ *
+ * Authors: Douglas Martins, Gustavo Zambonin,
+ *          Marcello Klingelfus
+ */
+#include "batch.h"
+#include "compiler.h"
+#include "parser.h"
+#include "pyc.h"
+#include "server.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <thread>
+#include <unistd.h>
+
+int main(int argc, char **argv) {
+  static const struct option options[] = {
+      {"serve", required_argument, nullptr, 'S'},
+      {"connect", required_argument, nullptr, 'C'},
+      {"idiomatic", no_argument, nullptr, 'I'},
+      {"typed-arrays", no_argument, nullptr, 'A'},
+      {"pyc", no_argument, nullptr, 'P'},
+      {"stats", optional_argument, nullptr, 't'},
+      {"stream", no_argument, nullptr, 's'},
+      {nullptr, 0, nullptr, 0}};
+
+  Batch batch;
+  const char *serve = nullptr, *remote = nullptr;
+  Target target = prefix_code;
+  int xflag = 0, listed = 0, python = 0, stats = 0, json = 0, streaming = 0,
+      optimize = 0;
+  char c;
+
+  batch.jobs = std::thread::hardware_concurrency();
+  while ((c = getopt_long(argc, argv, "dpcxtOj:o:m:", options, nullptr)) != -1)
+    switch (c) {
+    case 'S':
+      serve = optarg;
+      break;
+    case 'C':
+      remote = optarg;
+      break;
+    case 'I':
+      python |= AST::python_idioms;
+      break;
+    case 'A':
+      python |= AST::python_arrays;
+      break;
+    case 'P':
+      target = pyc_code;
+      break;
+    case 't':
+      if (optarg != nullptr && std::strcmp(optarg, "json") != 0) {
+        std::fprintf(stderr, "--stats is either plain or `--stats=json`\n");
+        return 1;
+      }
+      stats = 1;
+      json = optarg != nullptr;
+      break;
+    case 's':
+      streaming = 1;
+      break;
+    case 'd':
+      yydebug = 1;
+      break;
+    case 'p':
+      target = python_code;
+      break;
+    case 'c':
+      target = c_code;
+      break;
+    case 'x':
+      xflag = 1;
+      break;
+    case 'O':
+      optimize = 1;
+      break;
+    case 'j':
+      batch.jobs = std::atoi(optarg);
+      break;
+    case 'o':
+      batch.outdir = optarg;
+      break;
+    case 'm':
+      if (!batch.manifest(optarg)) {
+        std::fprintf(stderr, "%s: %s\n", optarg, std::strerror(errno));
+        return 1;
+      }
+      listed = 1;
+      break;
+    default:
+      return 1;
+    }
+
+  // source files on the command line are compiled as a batch
+  batch.files.insert(batch.files.end(), argv + optind, argv + argc);
+
+  // programs are only run from the standard input, in this process
+  if (xflag && (serve != nullptr || remote != nullptr || listed ||
+                !batch.files.empty())) {
+    std::fprintf(stderr, "-x runs a single program from standard input\n");
+    return 1;
+  }
+
+  // the other targets need the whole syntax tree at once
+  if (streaming && (xflag || target != prefix_code || serve != nullptr ||
+                    remote != nullptr)) {
+    std::fprintf(stderr, "--stream only writes prefix notation locally\n");
+    return 1;
+  }
+
+  // a server keeps no statistics of its requests
+  if (stats && (serve != nullptr || remote != nullptr)) {
+    std::fprintf(stderr, "--stats is only kept by local compilations\n");
+    return 1;
+  }
+
+  if (serve != nullptr) {
+    Server server(serve);
+    if (!server.ready()) {
+      std::fprintf(stderr, "%s: %s\n", serve, std::strerror(errno));
+      return 1;
+    }
+    // every request says whether it wants to be traced
+    yydebug = 0;
+    server.serve();
+    return 1;
+  }
+
+  if (remote != nullptr) {
+    Client client(remote);
+    if (!client.ready()) {
+      std::fprintf(stderr, "%s: %s\n", remote, std::strerror(errno));
+      return 1;
+    }
+    std::uint32_t flags = (target == python_code ? python_flag : 0) |
+                          (target == c_code ? c_flag : 0) |
+                          (target == pyc_code ? pyc_flag : 0) |
+                          (python & AST::python_idioms ? idioms_flag : 0) |
+                          (python & AST::python_arrays ? arrays_flag : 0) |
+                          (optimize ? optimize_flag : 0) |
+                          (yydebug ? debug_flag : 0);
+    return client.run(batch.files, flags) != 0;
+  }
+
+  // a server may embed Python even if this build does not
+  if (target == pyc_code && !PYC::available()) {
+    std::fprintf(stderr, "--pyc needs a build with `make PYC=yes`\n");
+    return 1;
+  }
+  Stats counters;
+  if (listed || !batch.files.empty()) {
+    batch.target = target;
+    batch.python = python;
+    batch.optimize = optimize;
+    batch.stats = stats ? &counters : nullptr;
+    batch.streaming = streaming;
+    int failures = batch.run();
+    if (stats) {
+      counters.report(stderr, json);
+    }
+    return failures != 0;
+  }
+
+  AST::Writer out(STDOUT_FILENO);
+  bool ok = true;
+  {
+    // the statistics are complete once the compilation is torn down
+    Compiler compilation(out);
+    compilation.python = python;
+    compilation.optimize = optimize;
+    compilation.stats = stats ? &counters : nullptr;
+    compilation.streaming = streaming;
+    compilation.parse(stdin);
+    if (xflag) {
+      ok = compilation.execute(yydebug);
+    } else {
+      compilation.emit(target);
+    }
+
+    if (yydebug) {
+      std::fprintf(stderr, "arena: %zu nodes, %zu bytes\n",
+                   compilation.arena.nodes(), compilation.arena.bytes());
+    }
+  }
+  if (stats) {
+    counters.report(stderr, json);
+  }
+
+  return ok ? 0 : 1;
+}
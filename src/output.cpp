@@ -0,0 +1,52 @@
+#include "output.h"
+#include <cerrno>
+#include <cstdio>
+#include <unistd.h>
+
+namespace AST {
+
+/* Run of blanks copied for indentation. */
+static const char _blank[] = "                                                "
+                             "                                                ";
+
+void Writer::write(int v) {
+  char s[16];
+  int n = std::snprintf(s, sizeof(s), "%d", v);
+  write(s, static_cast<std::size_t>(n));
+}
+
+void Writer::indent(int n) {
+  const int run = sizeof(_blank) - 1;
+  for (; n > run; n -= run) {
+    write(_blank, run);
+  }
+  if (n > 0) {
+    write(_blank, static_cast<std::size_t>(n));
+  }
+}
+
+void Writer::flush() {
+  sink(buffer, used);
+  used = 0;
+}
+
+void Writer::sink(const char *s, std::size_t n) {
+  if (str != nullptr) {
+    str->append(s, n);
+    return;
+  }
+  while (n > 0) {
+    ssize_t w = ::write(fd, s, n);
+    if (w < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      std::perror("write");
+      return;
+    }
+    s += w;
+    n -= static_cast<std::size_t>(w);
+  }
+}
+
+} // namespace AST
@@ -5,28 +5,33 @@
  * Authors: Douglas Martins, Gustavo Zambonin,
  *          Marcello Klingelfus
  */
-%{
-  #include "ast.h"
-  #include "st.h"
-  #include <cstring>
-  #include <unistd.h>
-
-  extern int yylex();
-  extern int yylex_destroy();
-  extern void yyerror(const char *s, ...);
+%code requires {
+  #include "compiler.h"
+}
 
-  /* First symbol table (global scope). */
-  ST::SymbolTable *current;
+%code {
+  /* Parser traces belong with the diagnostics of their compilation. */
+  #define YYFPRINTF(stream, ...)                                             \
+    std::fprintf(compiler->diagnostics, __VA_ARGS__)
 
-  /* Root of the abstract syntax tree. */
-  AST::BlockNode *root;
+  extern int yylex(YYSTYPE *lvalp, yyscan_t scanner);
+  extern void yyerror(yyscan_t scanner, Compiler *ctx, const char *s);
 
-  /* Temporary variable used to simplify the grammar on declarations. */
-  int tmp_t;
+  /* Tokens are counted and timed when the compilation keeps statistics. */
+  static int _yylex(YYSTYPE *lvalp, yyscan_t scanner) {
+    if (compiler->stats == nullptr) {
+      return yylex(lvalp, scanner);
+    }
+    Stats::Timer t(compiler->stats, Stats::lexing);
+    ++compiler->stats->tokens;
+    return yylex(lvalp, scanner);
+  }
+  #define yylex _yylex
 
-  /* Temporary variable used to insert the functor node inside the program. */
-  AST::Node *tmp_f;
-%}
+  /* Machine-generated code may nest expressions far deeper than people
+     do; the stacks of the parser grow on the heap up to this depth. */
+  #define YYMAXDEPTH 10000000
+}
 
 /* Bison declaration summary. */
 
@@ -36,6 +41,12 @@
 /* Instrument the parser for traces. */
 %define parse.trace
 
+/* Keep the parser state on the stack, so that several compilations may run
+   at once; the scanner and the compilation are handed to every call. */
+%define api.pure full
+%param {yyscan_t scanner}
+%parse-param {Compiler *ctx}
+
 /* Write a parser header file containing macro definitions for the token
    type names defined in the grammar. */
 %defines "include/parser.h"
@@ -47,22 +58,19 @@
 %union {
   int integer;
   bool boolean;
-  char *word;
+  AST::Name word;
+  AST::View view;
   AST::Node *node;
   AST::BlockNode *block;
 }
 
-/* Delete symbols automatically discarded. */
-%destructor { free($$); } <word>
-%destructor { delete $$; } <node>
-%destructor { delete $$; } <block>
-
 /* Definition of tokens and their types. */
 %token NL COMMA ASSIGN APPEND LPAR RPAR LCURLY RCURLY LBRAC RBRAC
 %token IF THEN ELSE FOR T_INT T_FLOAT T_BOOL T_CHAR FUN RET ARR RET_L
 %token <integer> INT
 %token <boolean> BOOL
-%token <word> ID FLOAT CHAR STR F_MAP F_FOLD F_FILTER F_LAMBDA L_CALL
+%token <word> ID F_MAP F_FOLD F_FILTER F_LAMBDA L_CALL
+%token <view> FLOAT CHAR STR
 
 /* Nonterminal symbols and their types. */
 %type <block> lines else body f-body f-expr
@@ -91,37 +99,34 @@
 /* Sets the root of the syntax tree and initializes the global scope. */
 program
   : %empty                        {}
-  | start-scope lines end-scope   { root = $2; }
+  | start-scope lines end-scope   { ctx->root = $2; }
   ;
 
 /* Initializes a new scope. */
 start-scope
-  : %empty  { current = new ST::SymbolTable(current); }
+  : %empty  { ctx->table.openScope(); }
   ;
 
 /* Cleans up the current scope and configures the grammar to use its parent. */
 end-scope
   : %empty
     {
-      if (current->external != nullptr) {
-        ST::SymbolTable* pt = current;
-        current = current->external;
-        delete pt;
-      } else {
-        delete current;
-      }
-      tmp_t = 0;
-      tmp_f = 0;
+      ctx->table.closeScope();
+      ctx->tmp_t = 0;
+      ctx->tmp_f = 0;
     }
 
-/* Stores every derived line on the abstract syntax tree. */
+/* Stores every derived line on the abstract syntax tree, unless the lines of
+   the program are streamed. */
 lines
   : line
-    { $$ = new AST::BlockNode($1); }
+    { $$ = new AST::BlockNode($1);
+      ctx->stream($$); }
   | lines line
-    { $1->nodeList.push_back(tmp_f);
-      $1->nodeList.push_back($2);
-      $$ = $1; }
+    { $1->hoist(ctx->tmp_f);
+      $1->push($2);
+      $$ = $1;
+      ctx->stream($$); }
   ;
 
 /*
@@ -135,37 +140,37 @@ lines
  */
 line
   : NL
-    { $$ = 0; tmp_t = 0; tmp_f = 0; }
+    { $$ = 0; ctx->tmp_t = 0; ctx->tmp_f = 0; }
   | d-type declaration
     { $$ = new AST::MessageNode($2, $1); }
   | d-type decl-array
     { $$ = new AST::MessageNode($2, $1 + 4); }
   | ref-cnt ID ASSIGN expr
-    { AST::Node* n = current->getVarFromTable($2);
+    { AST::Node* n = ctx->table.getVarFromTable($2);
       if ($1) n = new AST::UnaryOpNode(AST::ref, n);
       $$ = new AST::BinaryOpNode(AST::assign, n, $4); }
   | ref-cnt ID APPEND expr
-    { AST::Node* n = current->getVarFromTable($2);
+    { AST::Node* n = ctx->table.getVarFromTable($2);
       if ($1) n = new AST::UnaryOpNode(AST::ref, n);
       $$ = new AST::BinaryOpNode(AST::append, n, $4); }
   | ref-cnt ID LBRAC expr RBRAC ASSIGN expr
-    { AST::Node* n = current->getVarFromTable($2);
+    { AST::Node* n = ctx->table.getVarFromTable($2);
       if ($1) n = new AST::UnaryOpNode(AST::ref, n);
       AST::Node* left = new AST::BinaryOpNode(AST::index, n, $4);
       $$ = new AST::BinaryOpNode(AST::assign, left, $7); }
   | ref-cnt ID ASSIGN f-type LPAR f-lambda COMMA ID RPAR
-    { AST::VariableNode* n = current->getVarFromTable($8);
-      AST::VariableNode* p = current->getVarFromTable($2);
+    { AST::VarRefNode* n = ctx->table.getVarFromTable($8);
+      AST::VarRefNode* p = ctx->table.getVarFromTable($2);
       AST::HiOrdFuncNode* m = AST::HiOrdFuncNode::chooseFunc($4, $6, n);
       AST::Node* o = new AST::FuncCallNode(m, new AST::BlockNode(n));
       $$ = new AST::BinaryOpNode(AST::assign, p, o);
-      tmp_f = m; free($4); }
+      ctx->tmp_f = m; }
   | IF expr NL THEN LCURLY NL body else
     { $$ = new AST::IfNode($2, $7, $8); }
   | FOR iteration COMMA expr COMMA iteration LCURLY NL body
     { $$ = new AST::ForNode($2, $4, $6, $9); }
   | d-type is-array FUN ID start-scope LPAR decl-func RPAR f-body end-scope
-    { $$ = current->newFunction($4, $7, $1 + $2, $9); }
+    { $$ = ctx->table.newFunction($4, $7, $1 + $2, $9); }
   | f-lambda
     { $$ = $1; }
   | error line
@@ -175,18 +180,18 @@ line
 /* Defines the primitive types accepted by the language. */
 basic-type
   : INT   { $$ = new AST::IntNode($1); }
-  | FLOAT { $$ = new AST::FloatNode($1); free($1); }
+  | FLOAT { $$ = new AST::FloatNode($1); }
   | BOOL  { $$ = new AST::BoolNode($1); }
-  | CHAR  { $$ = new AST::CharNode($1); free($1); }
-  | STR   { $$ = new AST::CharNode($1); free($1); }
+  | CHAR  { $$ = new AST::CharNode($1); }
+  | STR   { $$ = new AST::CharNode($1); }
   ;
 
 /* Defines the primitive types accepted by the grammar. */
 d-type
-  : T_INT ref-cnt   { $$ = 0 + $2; tmp_t += 0; }
-  | T_FLOAT ref-cnt { $$ = 1 + $2; tmp_t += 1; }
-  | T_BOOL ref-cnt  { $$ = 2 + $2; tmp_t += 2; }
-  | T_CHAR ref-cnt  { $$ = 3 + $2; tmp_t += 3; }
+  : T_INT ref-cnt   { $$ = 0 + $2; ctx->tmp_t += 0; }
+  | T_FLOAT ref-cnt { $$ = 1 + $2; ctx->tmp_t += 1; }
+  | T_BOOL ref-cnt  { $$ = 2 + $2; ctx->tmp_t += 2; }
+  | T_CHAR ref-cnt  { $$ = 3 + $2; ctx->tmp_t += 3; }
   ;
 
 /* Checks if the return type of a function is an array. */
@@ -198,7 +203,7 @@ is-array
 /* Counts how many pointer references are being made. */
 ref-cnt
   : %empty      { $$ = 0; }
-  | ref-cnt REF { $$ = $1 + 8; tmp_t += 8; }
+  | ref-cnt REF { $$ = $1 + 8; ctx->tmp_t += 8; }
   ;
 
 /* Defines the valid higher order function types. */
@@ -212,23 +217,23 @@ f-type
    of one or multiple variables of the same type. */
 declaration
   : ID
-    { $$ = current->newVariable($1, nullptr, tmp_t, 0); }
+    { $$ = ctx->table.newVariable($1, nullptr, ctx->tmp_t, 0); }
   | ID ASSIGN basic-type
-    { AST::Node* n = current->newVariable($1, nullptr, tmp_t, 0);
+    { AST::Node* n = ctx->table.newVariable($1, nullptr, ctx->tmp_t, 0);
       $$ = new AST::BinaryOpNode(AST::assign, n, $3); }
   | declaration COMMA ID
-    { $$ = current->newVariable($3, $1, tmp_t, 0); }
+    { $$ = ctx->table.newVariable($3, $1, ctx->tmp_t, 0); }
   | declaration COMMA ID ASSIGN basic-type
-    { AST::Node* n = current->newVariable($3, $1, tmp_t, 0);
+    { AST::Node* n = ctx->table.newVariable($3, $1, ctx->tmp_t, 0);
       if (n != $1) $$ = new AST::BinaryOpNode(AST::assign, n, $5); }
   ;
 
 /* Defines the declaration of one or multiple arrays of the same type. */
 decl-array
   : ID LBRAC INT RBRAC
-    { $$ = current->newVariable($1, nullptr, tmp_t + 4, $3); }
+    { $$ = ctx->table.newVariable($1, nullptr, ctx->tmp_t + 4, $3); }
   | decl-array COMMA ID LBRAC INT RBRAC
-    { $$ = current->newVariable($3, $1, tmp_t + 4, $5); }
+    { $$ = ctx->table.newVariable($3, $1, ctx->tmp_t + 4, $5); }
   ;
 
 /* Defines the possible parameters for a function. */
@@ -236,21 +241,21 @@ decl-func
   : %empty
     { $$ = nullptr; }
   | d-type ID
-    { $$ = current->newVariable($2, nullptr, $1, 0, true); }
+    { $$ = ctx->table.newVariable($2, nullptr, $1, 0, true); }
   | d-type ID LPAR INT RPAR
-    { $$ = current->newVariable($2, nullptr, $1 + 4, $4, true); }
+    { $$ = ctx->table.newVariable($2, nullptr, $1 + 4, $4, true); }
   | decl-func COMMA d-type ID
-    { $$ = current->newVariable($4, $1, $3, 0, true); }
+    { $$ = ctx->table.newVariable($4, $1, $3, 0, true); }
   | decl-func COMMA d-type ID LPAR INT RPAR
-    { $$ = current->newVariable($4, $1, $3 + 4, $6, true); }
+    { $$ = ctx->table.newVariable($4, $1, $3 + 4, $6, true); }
   ;
 
 /* Defines the parameter list for an anonymous function. */
 decl-lambda
   : d-type ID
-    { $$ = current->newVariable($2, nullptr, $1, 0, true); }
+    { $$ = ctx->table.newVariable($2, nullptr, $1, 0, true); }
   | decl-lambda COMMA ID
-    { $$ = current->newVariable($3, $1, $1->_type(), 0, true); }
+    { $$ = ctx->table.newVariable($3, $1, $1->_type(), 0, true); }
   ;
 
 /* Represents the lines inside `if` or `for` operations. */
@@ -270,7 +275,7 @@ iteration
   : %empty
     { $$ = new AST::Node(); }
   | ID ASSIGN expr
-    { AST::Node* n = current->getVarFromTable($1);
+    { AST::Node* n = ctx->table.getVarFromTable($1);
       $$ = new AST::BinaryOpNode(AST::assign, n, $3); }
   ;
 
@@ -279,17 +284,17 @@ f-body
   : %empty
     { $$ = nullptr; }
   | LCURLY lines RET expr NL RCURLY
-    { $2->nodeList.push_back(new AST::ReturnNode($4)); $$ = $2; }
+    { $2->push(new AST::ReturnNode($4)); $$ = $2; }
   ;
 
 /* Defines syntax sugar for an anonymous function. */
 f-lambda
   : F_LAMBDA start-scope decl-lambda RET_L expr end-scope
     { AST::BlockNode* c = new AST::BlockNode(new AST::ReturnNode($5));
-      $$ = current->newFunction($1, $3, $5->_type(), c); }
+      $$ = ctx->table.newFunction($1, $3, $5->_type(), c); }
   | L_CALL LPAR RPAR
-    { current->entryList[ST::SymbolType::function].erase($1);
-      $$ = 0; free($1); }
+    { ctx->table.removeSymbol(ST::SymbolType::function, $1);
+      $$ = 0; }
   ;
 
 /* Defines the arithmetic, casting and logic operations of the language. */
@@ -323,15 +328,15 @@ expr
 /* Defines the use of variables and functions. */
 v-expr
   : ID
-    { $$ = current->getVarFromTable($1); }
+    { $$ = ctx->table.getVarFromTable($1); }
   | ID LBRAC expr RBRAC
-    { AST::Node* n = current->getVarFromTable($1);
+    { AST::Node* n = ctx->table.getVarFromTable($1);
       $$ = new AST::BinaryOpNode(AST::index, n, $3); }
   | ID LPAR f-expr RPAR
-    { AST::FuncNode* n = current->getFuncFromTable($1);
+    { AST::FuncNode* n = ctx->table.getFuncFromTable($1);
       $$ = new AST::FuncCallNode(n, $3); }
   | L_CALL LPAR f-expr RPAR
-    { AST::FuncNode* n = current->getFuncFromTable($1);
+    { AST::FuncNode* n = ctx->table.getFuncFromTable($1);
       $$ = new AST::FuncCallNode(n, $3); }
   ;
 
@@ -339,41 +344,7 @@ v-expr
 f-expr
   : %empty            { $$ = new AST::BlockNode(); }
   | expr              { $$ = new AST::BlockNode($1); }
-  | f-expr COMMA expr { $1->nodeList.push_back($3); $$ = $1; }
+  | f-expr COMMA expr { $1->push($3); $$ = $1; }
   ;
 
 %%
-
-/* Additional C code. */
-
-int main(int argc, char **argv) {
-  int pyflag = 0;
-  char c;
-
-  while ((c = getopt(argc, argv, "dp")) != -1)
-    switch (c) {
-    case 'd':
-      yydebug = 1;
-      break;
-    case 'p':
-      pyflag = 1;
-      break;
-    default:
-      return 1;
-    }
-
-  yyparse();
-  if (root != nullptr) {
-    if (pyflag) {
-      printf("exec(open('src/scope_manager.py', 'r').read())\n");
-      root->printPython();
-    } else {
-      root->printPrefix();
-    }
-  }
-
-  delete root;
-  yylex_destroy();
-
-  return 0;
-}
@@ -0,0 +1,57 @@
+#include "pool.h"
+#include <thread>
+
+Pool::Pool(unsigned workers) : queues(workers > 0 ? workers : 1) {}
+
+void Pool::run(std::size_t tasks,
+               const std::function<void(std::size_t)> &task) {
+  std::size_t n = queues.size();
+
+  // worker `w` starts with the `w`-th contiguous slice of the tasks
+  for (std::size_t w = 0; w < n; ++w) {
+    for (std::size_t i = tasks * w / n; i < tasks * (w + 1) / n; ++i) {
+      queues[w].tasks.push_back(i);
+    }
+  }
+
+  // the calling thread is the first worker
+  std::vector<std::thread> threads;
+  for (std::size_t w = 1; w < n; ++w) {
+    threads.emplace_back(&Pool::work, this, w, std::cref(task));
+  }
+  work(0, task);
+  for (std::thread &t : threads) {
+    t.join();
+  }
+}
+
+bool Pool::next(std::size_t w, std::size_t &task) {
+  {
+    std::lock_guard<std::mutex> guard(queues[w].lock);
+    if (!queues[w].tasks.empty()) {
+      task = queues[w].tasks.front();
+      queues[w].tasks.pop_front();
+      return true;
+    }
+  }
+
+  // tasks are never added while running, so one sweep over
+  // the other queues finding nothing means all work is taken
+  for (std::size_t i = 1; i < queues.size(); ++i) {
+    Queue &victim = queues[(w + i) % queues.size()];
+    std::lock_guard<std::mutex> guard(victim.lock);
+    if (!victim.tasks.empty()) {
+      task = victim.tasks.back();
+      victim.tasks.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+void Pool::work(std::size_t w, const std::function<void(std::size_t)> &task) {
+  std::size_t i;
+  while (next(w, i)) {
+    task(i);
+  }
+}
@@ -0,0 +1,105 @@
+#include "pyc.h"
+
+#ifdef LUKA_PYC
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <marshal.h>
+#include <mutex>
+
+namespace PYC {
+
+/* Whether the interpreter started, set once by the first compilation. */
+static bool _ready = false;
+static std::once_flag _start;
+
+/* Starts an isolated interpreter, which ignores the environment and the
+ * site packages, and lets go of the lock so that any thread may take it. */
+static void _initialize() {
+  PyConfig config;
+  PyConfig_InitIsolatedConfig(&config);
+  config.site_import = 0;
+  PyStatus status = Py_InitializeFromConfig(&config);
+  PyConfig_Clear(&config);
+  if (!PyStatus_Exception(status)) {
+    _ready = true;
+    PyEval_SaveThread();
+  }
+}
+
+/* Appends a 32-bit word in little-endian order. */
+static void _word(std::string &pyc, unsigned long w) {
+  for (int i = 0; i < 4; ++i) {
+    pyc.push_back(static_cast<char>((w >> (8 * i)) & 0xff));
+  }
+}
+
+/* Takes the message of the pending exception. */
+static std::string _exception() {
+  PyObject *type, *value, *trace;
+  PyErr_Fetch(&type, &value, &trace);
+  std::string message = "unknown error";
+  PyObject *text = value != nullptr ? PyObject_Str(value) : nullptr;
+  const char *s = text != nullptr ? PyUnicode_AsUTF8(text) : nullptr;
+  if (s != nullptr) {
+    message = s;
+  }
+  PyErr_Clear();
+  Py_XDECREF(text);
+  Py_XDECREF(type);
+  Py_XDECREF(value);
+  Py_XDECREF(trace);
+  return message;
+}
+
+bool available() { return true; }
+
+bool compile(const std::string &source, const char *filename,
+             std::string &pyc, std::string &error) {
+  std::call_once(_start, _initialize);
+  if (!_ready) {
+    error = "could not start the Python interpreter";
+    return false;
+  }
+
+  PyGILState_STATE state = PyGILState_Ensure();
+  PyObject *code = Py_CompileStringExFlags(source.c_str(), filename,
+                                           Py_file_input, nullptr, -1);
+  PyObject *data = code != nullptr ? PyMarshal_WriteObjectToString(
+                                         code, Py_MARSHAL_VERSION)
+                                   : nullptr;
+  bool ok = data != nullptr;
+  if (ok) {
+    // flags of zero ask for a timestamp check, which is never made when
+    // the file is run directly, so the time and size are left at zero
+    _word(pyc, static_cast<unsigned long>(PyImport_GetMagicNumber()));
+    _word(pyc, 0);
+    _word(pyc, 0);
+    _word(pyc, 0);
+    pyc.append(PyBytes_AS_STRING(data), PyBytes_GET_SIZE(data));
+  } else {
+    error = _exception();
+  }
+  Py_XDECREF(data);
+  Py_XDECREF(code);
+  PyGILState_Release(state);
+  return ok;
+}
+
+} // namespace PYC
+
+#else
+
+namespace PYC {
+
+bool available() { return false; }
+
+bool compile(const std::string &, const char *, std::string &,
+             std::string &error) {
+  error = "built without an embedded Python";
+  return false;
+}
+
+} // namespace PYC
+
+#endif
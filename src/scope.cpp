@@ -0,0 +1,103 @@
+#include "scope.h"
+#include <algorithm>
+
+namespace ST {
+
+/* Mixes the address of an interned name with the symbol kind. */
+static std::size_t _hash(SymbolType type, AST::Name key) {
+  auto h = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(key));
+  h = (h ^ static_cast<std::uint64_t>(type)) * 0x9E3779B97F4A7C15ULL;
+  return static_cast<std::size_t>(h >> 32);
+}
+
+std::size_t Scopes::probe(SymbolType type, AST::Name key) const {
+  std::size_t mask = slots.size() - 1;
+  std::size_t i = _hash(type, key) & mask;
+  while (slots[i].key != nullptr &&
+         (slots[i].key != key || slots[i].type != type)) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+void Scopes::grow() {
+  std::vector<Slot> old(2 * slots.size());
+  old.swap(slots);
+
+  // bindings refer to slots by index, so they have to be remapped
+  std::vector<std::uint32_t> moved(old.size());
+  for (std::size_t i = 0; i < old.size(); ++i) {
+    if (old[i].key != nullptr) {
+      std::size_t j = probe(old[i].type, old[i].key);
+      slots[j] = old[i];
+      moved[i] = static_cast<std::uint32_t>(j);
+    }
+  }
+  for (Binding &b : bindings) {
+    b.slot = moved[b.slot];
+  }
+}
+
+void Scopes::close() {
+  std::size_t mark = marks.back();
+  marks.pop_back();
+  while (bindings.size() > mark) {
+    const Binding &b = bindings.back();
+    slots[b.slot].head = b.prev;
+    bindings.pop_back();
+  }
+}
+
+void Scopes::bind(SymbolType type, AST::Name key, void *symbol) {
+  std::size_t i = probe(type, key);
+  if (slots[i].key == nullptr) {
+    // keep the load factor under one half
+    if (2 * (used + 1) > slots.size()) {
+      grow();
+      i = probe(type, key);
+    }
+    slots[i].key = key;
+    slots[i].type = type;
+    ++used;
+  }
+
+  Binding b = {static_cast<std::uint32_t>(i), slots[i].head, symbol};
+  slots[i].head = static_cast<std::int32_t>(bindings.size());
+  bindings.push_back(b);
+}
+
+void Scopes::unbind(SymbolType type, AST::Name key) {
+  std::size_t i = probe(type, key);
+  std::int32_t head = slots[i].head;
+  if (head >= 0 && static_cast<std::size_t>(head) >= innermost()) {
+    // the binding itself stays on the stack until the scope closes,
+    // where restoring its predecessor once more is harmless
+    slots[i].head = bindings[head].prev;
+  }
+}
+
+void *Scopes::find(SymbolType type, AST::Name key) const {
+  std::int32_t head = slots[probe(type, key)].head;
+  return (head < 0) ? nullptr : bindings[head].symbol;
+}
+
+void *Scopes::findHere(SymbolType type, AST::Name key) const {
+  std::int32_t head = slots[probe(type, key)].head;
+  if (head < 0 || static_cast<std::size_t>(head) < innermost()) {
+    return nullptr;
+  }
+  return bindings[head].symbol;
+}
+
+std::size_t Scopes::distance(SymbolType type, AST::Name key) const {
+  std::int32_t head = slots[probe(type, key)].head;
+  if (head < 0) {
+    return 0;
+  }
+  // the binding belongs to the last scope opened before it was made
+  auto scope = std::upper_bound(marks.begin(), marks.end(),
+                                static_cast<std::size_t>(head));
+  return static_cast<std::size_t>(marks.end() - scope);
+}
+
+} // namespace ST
@@ -0,0 +1,248 @@
+#include "server.h"
+#include "compiler.h"
+#include "parser.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+/* Largest source accepted in a single request. */
+static const std::uint32_t _limit = 1U << 28;
+
+/* The parser trace is switched on by a global flag, so a request that
+   asks for it runs alone, while any others may parse together. */
+static pthread_rwlock_t _trace = PTHREAD_RWLOCK_INITIALIZER;
+
+/* Reads exactly `n` bytes from a socket. */
+static bool _read(int fd, void *data, std::size_t n) {
+  char *p = static_cast<char *>(data);
+  while (n > 0) {
+    ssize_t r = recv(fd, p, n, 0);
+    if (r < 0 && errno == EINTR) {
+      continue;
+    }
+    if (r <= 0) {
+      return false;
+    }
+    p += r;
+    n -= r;
+  }
+  return true;
+}
+
+/* Writes exactly `n` bytes to a socket. */
+static bool _write(int fd, const void *data, std::size_t n) {
+  const char *p = static_cast<const char *>(data);
+  while (n > 0) {
+    ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+    if (w < 0 && errno == EINTR) {
+      continue;
+    }
+    if (w < 0) {
+      return false;
+    }
+    p += w;
+    n -= w;
+  }
+  return true;
+}
+
+/* Fills the address of the socket at `path`. */
+static bool _address(const char *path, sockaddr_un &addr) {
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (std::strlen(path) >= sizeof(addr.sun_path)) {
+    errno = ENAMETOOLONG;
+    return false;
+  }
+  std::strcpy(addr.sun_path, path);
+  return true;
+}
+
+/* Compiles the source of a single request. */
+static void _compile(const std::string &source, std::uint32_t flags,
+                     std::string &code, std::string &diagnostics) {
+  char *text = nullptr;
+  std::size_t length = 0;
+  FILE *diag = open_memstream(&text, &length);
+  {
+    AST::Writer out(&code);
+    Compiler c(out);
+    c.diagnostics = diag;
+
+    // an empty stream cannot be opened, and would not parse to anything
+    if (!source.empty()) {
+      FILE *in = fmemopen(const_cast<char *>(source.data()), source.size(),
+                          "r");
+      if (flags & debug_flag) {
+        pthread_rwlock_wrlock(&_trace);
+        yydebug = 1;
+        c.parse(in);
+        yydebug = 0;
+      } else {
+        pthread_rwlock_rdlock(&_trace);
+        c.parse(in);
+      }
+      pthread_rwlock_unlock(&_trace);
+      std::fclose(in);
+    }
+    c.python = ((flags & idioms_flag) ? AST::python_idioms : 0) |
+               ((flags & arrays_flag) ? AST::python_arrays : 0);
+    c.optimize = (flags & optimize_flag) != 0;
+    c.emit((flags & c_flag)        ? c_code
+           : (flags & pyc_flag)    ? pyc_code
+           : (flags & python_flag) ? python_code
+                                   : prefix_code);
+
+    if (flags & debug_flag) {
+      std::fprintf(diag, "arena: %zu nodes, %zu bytes\n", c.arena.nodes(),
+                   c.arena.bytes());
+    }
+  }
+  std::fclose(diag);
+  diagnostics.assign(text, length);
+  std::free(text);
+}
+
+Server::Server(const char *path) : path(path) {
+  sockaddr_un addr;
+  if (!_address(path, addr)) {
+    return;
+  }
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return;
+  }
+  unlink(path);
+  if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+      listen(fd, SOMAXCONN) < 0) {
+    int error = errno;
+    close(fd);
+    fd = -1;
+    errno = error;
+  }
+}
+
+Server::~Server() {
+  if (fd >= 0) {
+    close(fd);
+    unlink(path.c_str());
+  }
+}
+
+void Server::serve() {
+  for (;;) {
+    int conn = accept(fd, nullptr, nullptr);
+    if (conn >= 0) {
+      std::thread(answer, conn).detach();
+    } else if (errno != EINTR && errno != ECONNABORTED) {
+      return;
+    }
+  }
+}
+
+void Server::answer(int conn) {
+  std::uint32_t header[2];
+  while (_read(conn, header, sizeof(header)) && header[1] <= _limit) {
+    std::string source(header[1], '\0');
+    if (!_read(conn, &source[0], source.size())) {
+      break;
+    }
+
+    std::string code, diagnostics;
+    _compile(source, header[0], code, diagnostics);
+
+    std::uint32_t reply[2] = {static_cast<std::uint32_t>(code.size()),
+                              static_cast<std::uint32_t>(diagnostics.size())};
+    if (!_write(conn, reply, sizeof(reply)) ||
+        !_write(conn, code.data(), code.size()) ||
+        !_write(conn, diagnostics.data(), diagnostics.size())) {
+      break;
+    }
+  }
+  close(conn);
+}
+
+Client::Client(const char *path) {
+  sockaddr_un addr;
+  if (!_address(path, addr)) {
+    return;
+  }
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd >= 0 &&
+      connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+    int error = errno;
+    close(fd);
+    fd = -1;
+    errno = error;
+  }
+}
+
+Client::~Client() {
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+bool Client::compile(const std::string &source, std::uint32_t flags,
+                     std::string &code, std::string &diagnostics) {
+  std::uint32_t header[2] = {flags, static_cast<std::uint32_t>(source.size())};
+  std::uint32_t reply[2];
+  if (source.size() > _limit || !_write(fd, header, sizeof(header)) ||
+      !_write(fd, source.data(), source.size()) ||
+      !_read(fd, reply, sizeof(reply))) {
+    return false;
+  }
+  code.resize(reply[0]);
+  diagnostics.resize(reply[1]);
+  return _read(fd, &code[0], code.size()) &&
+         _read(fd, &diagnostics[0], diagnostics.size());
+}
+
+int Client::run(const std::vector<std::string> &files, std::uint32_t flags) {
+  int failures = 0;
+  for (std::size_t i = 0; i == 0 || i < files.size(); ++i) {
+    std::string source, code, diagnostics;
+    if (files.empty()) {
+      source.assign(std::istreambuf_iterator<char>(std::cin),
+                    std::istreambuf_iterator<char>());
+    } else {
+      std::ifstream in(files[i], std::ios::binary);
+      if (!in) {
+        std::fprintf(stderr, "%s: %s\n", files[i].c_str(),
+                     std::strerror(errno));
+        ++failures;
+        continue;
+      }
+      source.assign(std::istreambuf_iterator<char>(in),
+                    std::istreambuf_iterator<char>());
+    }
+
+    if (!compile(source, flags, code, diagnostics)) {
+      std::fprintf(stderr, "lost connection to the server\n");
+      return failures + 1;
+    }
+    std::fwrite(code.data(), 1, code.size(), stdout);
+    std::fflush(stdout);
+
+    // diagnostics are tagged like those of a batch
+    std::size_t start = 0;
+    while (start < diagnostics.size()) {
+      std::size_t end = diagnostics.find('\n', start);
+      end = (end == std::string::npos) ? diagnostics.size() : end + 1;
+      if (!files.empty()) {
+        std::fprintf(stderr, "%s: ", files[i].c_str());
+      }
+      std::fwrite(diagnostics.data() + start, 1, end - start, stderr);
+      start = end;
+    }
+  }
+  return failures;
+}
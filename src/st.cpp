@@ -1,56 +1,46 @@
 #include "st.h"
-
-extern ST::SymbolTable *current;
+#include "compiler.h"
 
 namespace ST {
 
-void SymbolTable::addSymbol(SymbolType type, const std::string &key,
+void SymbolTable::addSymbol(SymbolType type, AST::Name key,
                             AST::Node *symbol) {
-  entryList[type][key] = symbol;
+  scopes.bind(type, key, symbol);
 }
 
-bool SymbolTable::symbolExistsHere(SymbolType type, const std::string &key) {
-  return entryList[type].count(key) == 1;
+bool SymbolTable::symbolExistsHere(SymbolType type, AST::Name key) {
+  return scopes.findHere(type, key) != nullptr;
 }
 
-AST::VariableNode *SymbolTable::getVarFromTable(char *key) {
-  std::string k(key);
-  free(key);
-  return getVarFromTable(k);
+void SymbolTable::removeSymbol(SymbolType type, AST::Name key) {
+  scopes.unbind(type, key);
 }
 
-AST::VariableNode *SymbolTable::getVarFromTable(const std::string &key) {
-  if (symbolExistsHere(SymbolType::variable, key)) {
-    AST::Node *n = entryList[SymbolType::variable][key];
-    return new AST::VariableNode(key, nullptr, n->_type(),
-                                 dynamic_cast<AST::VariableNode *>(n)->size);
+AST::VarRefNode *SymbolTable::getVarFromTable(AST::Name key) {
+  if (compiler->stats != nullptr) {
+    ++compiler->stats->variables;
+    compiler->stats->hops += scopes.distance(SymbolType::variable, key);
   }
-  if (external == nullptr) {
-    yyserror("undeclared variable %s", key.c_str());
-    return new AST::VariableNode(key, nullptr, -1, 0);
+  auto *n = static_cast<AST::VariableNode *>(
+      static_cast<AST::Node *>(scopes.find(SymbolType::variable, key)));
+  if (n == nullptr) {
+    yyserror("undeclared variable %s", key->c_str());
+    n = new AST::VariableNode(key, nullptr, -1, 0);
   }
-  return external->getVarFromTable(key);
+  return new AST::VarRefNode(n);
 }
 
-AST::Node *SymbolTable::newVariable(char *key, AST::Node *next, int type,
+AST::Node *SymbolTable::newVariable(AST::Name key, AST::Node *next, int type,
                                     int size, bool isParam) {
-  std::string k(key);
-  free(key);
-  return newVariable(k, next, type, size, isParam);
-}
-
-AST::Node *SymbolTable::newVariable(const std::string &key, AST::Node *next,
-                                    int type, int size, bool isParam) {
+  globals += (scopes.depth() == 1);
   if (symbolExistsHere(SymbolType::variable, key)) {
-    yyserror("re-declaration of variable %s", key.c_str());
+    yyserror("re-declaration of variable %s", key->c_str());
     // new variable is not added to the symbol table and
     // is skipped by returning `next` or the old node
-    AST::Node *old = getVarFromTable(key);
     if (next != nullptr) {
-      delete old;
       return next;
     }
-    return old;
+    return getVarFromTable(key);
   }
 
   AST::Node *n;
@@ -63,46 +53,37 @@ AST::Node *SymbolTable::newVariable(const std::string &key, AST::Node *next,
   return n;
 }
 
-AST::FuncNode *SymbolTable::getFuncFromTable(char *key) {
-  std::string k(key);
-  free(key);
-  return getFuncFromTable(k);
-}
-
-AST::FuncNode *SymbolTable::getFuncFromTable(const std::string &key) {
-  if (symbolExistsHere(SymbolType::function, key)) {
-    return dynamic_cast<AST::FuncNode *>(entryList[SymbolType::function][key]);
+AST::FuncNode *SymbolTable::getFuncFromTable(AST::Name key) {
+  if (compiler->stats != nullptr) {
+    ++compiler->stats->functions;
+    compiler->stats->hops += scopes.distance(SymbolType::function, key);
   }
-  if (external == nullptr) {
-    yyserror("undeclared function %s", key.c_str());
+  auto *n = static_cast<AST::Node *>(scopes.find(SymbolType::function, key));
+  if (n == nullptr) {
+    yyserror("undeclared function %s", key->c_str());
     return new AST::FuncNode(key, nullptr, -1, nullptr);
   }
-  return external->getFuncFromTable(key);
-}
-
-AST::Node *SymbolTable::newFunction(char *key, AST::Node *params, int type,
-                                    AST::BlockNode *contents) {
-  std::string k(key);
-  free(key);
-  return newFunction(k, params, type, contents);
+  return static_cast<AST::FuncNode *>(n);
 }
 
-AST::Node *SymbolTable::newFunction(std::string key, AST::Node *params,
+AST::Node *SymbolTable::newFunction(AST::Name key, AST::Node *params,
                                     int type, AST::BlockNode *contents) {
+  globals += (scopes.depth() == 1);
   if (symbolExistsHere(SymbolType::function, key)) {
     AST::FuncNode *n = getFuncFromTable(key);
     if (contents != nullptr && n->verifyParams(params)) {
+      // the body refers to the parameters of its own definition
+      n->params = params;
       n->contents = contents;
-      delete params;
     } else {
-      yyserror("re-definition of function %s", key.c_str());
+      yyserror("re-definition of function %s", key->c_str());
     }
     return nullptr;
   }
 
   AST::Node *n = new AST::FuncNode(key, params, type, contents);
   // make lambda function callable by the symbol
-  key = (key == "lambda") ? "λ" : key;
+  key = (*key == "lambda") ? AST::intern("λ") : key;
   addSymbol(SymbolType::function, key, n);
   return n;
 }
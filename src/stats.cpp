@@ -0,0 +1,93 @@
+#include "stats.h"
+
+/* Names of the phases, as reported. */
+static const char *const _phases[] = {"lexing", "parsing", "checking",
+                                      "emission", "teardown"};
+
+/* Names of the concrete classes of nodes, in the order of their kinds. */
+static const char *const _kinds[] = {
+    "Node", "IntNode", "FloatNode", "BoolNode", "CharNode", "BinaryOpNode",
+    "UnaryOpNode", "VarRefNode", "BlockNode", "IfNode", "ForNode",
+    "FuncCallNode", "MessageNode", "ReturnNode", "VariableNode", "ParamNode",
+    "DeclarationNode", "FuncNode", "HiOrdFuncNode", "MapFuncNode",
+    "FoldFuncNode", "FilterFuncNode"};
+
+static_assert(sizeof(_kinds) / sizeof(*_kinds) == AST::FILTER_FUNC_NODE + 1,
+              "every kind of node needs a name");
+
+void Stats::gather(const AST::Arena &a, const AST::Arena::Mark &since) {
+  const std::vector<AST::Node *> &owned = a.ownedNodes();
+  for (std::size_t i = since.owned; i < owned.size(); ++i) {
+    ++nodes[owned[i]->kind];
+  }
+  arena += a.bytes() - since.allocated;
+}
+
+void Stats::add(const Stats &other) {
+  for (int p = 0; p < phases; ++p) {
+    seconds[p] += other.seconds[p];
+  }
+  for (int k = 0; k <= AST::FILTER_FUNC_NODE; ++k) {
+    nodes[k] += other.nodes[k];
+  }
+  tokens += other.tokens;
+  variables += other.variables;
+  functions += other.functions;
+  hops += other.hops;
+  depth = (other.depth > depth) ? other.depth : depth;
+  source += other.source;
+  arena += other.arena;
+  names += other.names;
+}
+
+void Stats::report(FILE *out, bool json) const {
+  double total = 0;
+  std::size_t count = 0;
+  for (int p = 0; p < phases; ++p) {
+    total += seconds[p];
+  }
+  for (int k = 0; k <= AST::FILTER_FUNC_NODE; ++k) {
+    count += nodes[k];
+  }
+
+  if (json) {
+    std::fprintf(out, "{\"seconds\": {");
+    for (int p = 0; p < phases; ++p) {
+      std::fprintf(out, "\"%s\": %.9f, ", _phases[p], seconds[p]);
+    }
+    std::fprintf(out, "\"total\": %.9f}, \"tokens\": %zu, \"nodes\": {",
+                 total, tokens);
+    for (int k = 0; k <= AST::FILTER_FUNC_NODE; ++k) {
+      if (nodes[k] > 0) {
+        std::fprintf(out, "\"%s\": %zu, ", _kinds[k], nodes[k]);
+      }
+    }
+    std::fprintf(out,
+                 "\"total\": %zu}, \"lookups\": {\"variables\": %zu, "
+                 "\"functions\": %zu, \"hops\": %zu}, \"max_depth\": %zu, "
+                 "\"bytes\": {\"source\": %zu, \"arena\": %zu}, "
+                 "\"names\": %zu}\n",
+                 count, variables, functions, hops, depth, source, arena,
+                 names);
+    return;
+  }
+
+  for (int p = 0; p < phases; ++p) {
+    std::fprintf(out, "%-18s %12.6f s\n", _phases[p], seconds[p]);
+  }
+  std::fprintf(out, "%-18s %12.6f s\n", "total", total);
+  std::fprintf(out, "%-18s %12zu\n", "tokens", tokens);
+  std::fprintf(out, "%-18s %12zu\n", "nodes", count);
+  for (int k = 0; k <= AST::FILTER_FUNC_NODE; ++k) {
+    if (nodes[k] > 0) {
+      std::fprintf(out, "  %-16s %12zu\n", _kinds[k], nodes[k]);
+    }
+  }
+  std::fprintf(out, "%-18s %12zu\n", "variable lookups", variables);
+  std::fprintf(out, "%-18s %12zu\n", "function lookups", functions);
+  std::fprintf(out, "%-18s %12zu\n", "scope hops", hops);
+  std::fprintf(out, "%-18s %12zu\n", "max scope depth", depth);
+  std::fprintf(out, "%-18s %12zu\n", "source bytes", source);
+  std::fprintf(out, "%-18s %12zu\n", "arena bytes", arena);
+  std::fprintf(out, "%-18s %12zu\n", "interned names", names);
+}
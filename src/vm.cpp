@@ -0,0 +1,714 @@
+#include "vm.h"
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+
+namespace VM {
+
+/* Names of the operations, for listings. */
+static const char *const _names[] = {
+#define VM_NAME(name) #name,
+    VM_OPERATIONS(VM_NAME)
+#undef VM_NAME
+};
+
+/* Largest register, function or constant that an operand can name. */
+static const int _limit = 0xFFFF;
+
+/* Checks if an operation writes a new value to its register `a`, which
+   may then be retargeted; a call also reads its arguments from there. */
+static bool _produces(int op) {
+  return op != STOREUP && op != STORE && op != SETIDX && op != APPEND &&
+         op != JUMP && op != JUMPF && op != JUMPT && op != CALL &&
+         op != RET && op != HALT;
+}
+
+/* Checks if an operation reads `b` and `c` as a single wide operand. */
+static bool _wide(int op) {
+  return op == LOADI || op == NEWARR || op == JUMP || op == JUMPF ||
+         op == JUMPT;
+}
+
+/* Integer arithmetic that wraps around instead of overflowing. */
+static inline std::int64_t _wrap(std::uint64_t v) {
+  return static_cast<std::int64_t>(v);
+}
+
+/* Shortest text of a float that reads back to the same value. */
+static void _real(FILE *out, double f) {
+  char text[32];
+  for (int precision = 1; precision <= 17; ++precision) {
+    std::snprintf(text, sizeof(text), "%.*g", precision, f);
+    if (std::strtod(text, nullptr) == f) {
+      break;
+    }
+  }
+  bool integral = std::strpbrk(text, ".eni") == nullptr;
+  std::fprintf(out, integral ? "%s.0" : "%s", text);
+}
+
+void Program::disassemble(FILE *out) const {
+  for (std::size_t i = 0; i < functions.size(); ++i) {
+    const Function &f = functions[i];
+    if (i == 0) {
+      std::fprintf(out, "program: %d registers\n", f.frame);
+    } else {
+      std::fprintf(out, "function %zu %s: %d params, %d registers\n", i,
+                   f.name.c_str(), f.params, f.frame);
+    }
+    for (std::size_t pc = 0; pc < f.code.size(); ++pc) {
+      const Instr &in = f.code[pc];
+      std::fprintf(out, "%6zu  %-8s %5u", pc, _names[in.op], in.a);
+      if (_wide(in.op)) {
+        std::fprintf(out, " %11d\n", in.k());
+      } else {
+        std::fprintf(out, " %5u %5u %3u\n", in.b, in.c, in.x);
+      }
+    }
+  }
+}
+
+int Builder::build(AST::BlockNode *root) {
+  program.functions.emplace_back();
+  bodies.push_back(nullptr);
+  root->lower(*this);
+  emit(HALT);
+
+  // building a function may queue the ones defined inside it
+  for (std::size_t i = 1; i < program.functions.size(); ++i) {
+    AST::FuncNode *f = bodies[i];
+    current = i;
+    nesting = 0;
+    top = floor = 1;
+    std::deque<AST::VariableNode *> params = f->createDeque();
+    for (AST::VariableNode *p : params) {
+      declare(p);
+    }
+    program.functions[i].params = params.size();
+    f->contents->lower(*this);
+    emit(RET);
+  }
+  return errors;
+}
+
+int Builder::emit(Op op, int a, int b, int c, int x) {
+  std::vector<Instr> &code = program.functions[current].code;
+  Instr in = {op, static_cast<std::uint8_t>(x), static_cast<std::uint16_t>(a),
+              static_cast<std::uint16_t>(b), static_cast<std::uint16_t>(c)};
+  code.push_back(in);
+  return code.size() - 1;
+}
+
+int Builder::emitk(Op op, int a, std::int32_t k) {
+  std::uint32_t u = k;
+  return emit(op, a, u >> 16, u & 0xFFFF);
+}
+
+int Builder::here() const { return program.functions[current].code.size(); }
+
+void Builder::patch(int at) {
+  Instr &in = program.functions[current].code[at];
+  std::uint32_t u = here();
+  in.b = u >> 16;
+  in.c = u & 0xFFFF;
+}
+
+int Builder::temp() {
+  // globals are registers of the outermost block, and share its limit
+  if (top == _limit && current == 0) {
+    error("program needs more than %d registers for its globals", _limit);
+  } else if (top == _limit) {
+    error("function %s needs more than %d registers",
+          program.functions[current].name.c_str(), _limit);
+  }
+  Function &f = program.functions[current];
+  if (top >= f.frame) {
+    f.frame = top + 1;
+  }
+  return top++;
+}
+
+void Builder::move(int dst, int src) {
+  std::vector<Instr> &code = program.functions[current].code;
+  if (dst == src) {
+    return;
+  }
+  if (src >= floor && !code.empty() && code.back().a == src &&
+      _produces(code.back().op)) {
+    code.back().a = dst;
+  } else {
+    emit(MOVE, dst, src);
+  }
+}
+
+void Builder::block(AST::BlockNode *b) {
+  int scope = top;
+  ++nesting;
+  for (AST::Node *n : *b) {
+    n->lower(*this);
+    reset(scope);
+  }
+  --nesting;
+  top = floor = scope;
+}
+
+int Builder::constant(Value v) {
+  program.constants.push_back(v);
+  if (program.constants.size() > _limit) {
+    error("program has too many constants");
+  }
+  return program.constants.size() - 1;
+}
+
+int Builder::string(const AST::View &literal) {
+  program.strings.emplace_back(literal.data + 1, literal.size - 2);
+  if (program.strings.size() > _limit) {
+    error("program has too many strings");
+  }
+  return program.strings.size() - 1;
+}
+
+int Builder::declare(AST::VariableNode *v) {
+  int reg = temp();
+  floor = top;
+  slots[v] = {current, reg};
+  if (current == 0 && nesting == 1) {
+    program.globals.push_back({v->id, v->type, reg});
+  }
+  return reg;
+}
+
+int Builder::read(AST::VariableNode *v) {
+  auto s = slots.find(v);
+  int h = (s != slots.end()) ? hops(s->second.function) : -1;
+  if (h == 0) {
+    return s->second.reg;
+  }
+  int dst = temp();
+  if (h < 0) {
+    error("variable %s is used out of its scope", v->id->c_str());
+  } else {
+    emit(LOADUP, dst, s->second.reg, 0, h);
+  }
+  return dst;
+}
+
+void Builder::write(AST::VariableNode *v, int src) {
+  auto s = slots.find(v);
+  int h = (s != slots.end()) ? hops(s->second.function) : -1;
+  if (h == 0) {
+    move(s->second.reg, src);
+  } else if (h > 0) {
+    emit(STOREUP, src, s->second.reg, 0, h);
+  } else {
+    error("variable %s is used out of its scope", v->id->c_str());
+  }
+}
+
+int Builder::address(AST::VariableNode *v) {
+  auto s = slots.find(v);
+  int h = (s != slots.end()) ? hops(s->second.function) : -1;
+  int dst = temp();
+  if (h == 0) {
+    emit(ADDR, dst, s->second.reg);
+  } else if (h > 0) {
+    emit(ADDRUP, dst, s->second.reg, 0, h);
+  } else {
+    error("variable %s is used out of its scope", v->id->c_str());
+  }
+  return dst;
+}
+
+void Builder::define(AST::FuncNode *f) {
+  // a declaration without a body is only reported if it is called
+  if (f->contents == nullptr || indices.count(f) != 0) {
+    return;
+  }
+  indices[f] = program.functions.size();
+  program.functions.emplace_back();
+  program.functions.back().name = *f->id;
+  program.functions.back().parent = current;
+  bodies.push_back(f);
+  if (program.functions.size() > _limit) {
+    error("program has too many functions");
+  }
+}
+
+void Builder::call(AST::FuncNode *f, int args) {
+  // functors on the first line of a block never make it into the tree,
+  // and belong to the function that calls them
+  if (AST::HiOrdFuncNode::classof(f)) {
+    define(f);
+  }
+  auto i = indices.find(f);
+  if (i == indices.end()) {
+    error("function %s is called but never defined", f->id->c_str());
+    return;
+  }
+  int h = hops(program.functions[i->second].parent);
+  if (h < 0 || h > 0xFF) {
+    error("function %s is called out of its scope", f->id->c_str());
+  }
+  emit(CALL, args, i->second, 0, h);
+}
+
+void Builder::error(const char *format, ...) {
+  va_list ap;
+  va_start(ap, format);
+  std::fprintf(diagnostics, "bytecode error: ");
+  std::vfprintf(diagnostics, format, ap);
+  std::fprintf(diagnostics, "\n");
+  va_end(ap);
+  ++errors;
+}
+
+int Builder::hops(int f) const {
+  int n = 0;
+  for (int g = current; g >= 0; g = program.functions[g].parent, ++n) {
+    if (g == f) {
+      return n;
+    }
+  }
+  return -1;
+}
+
+Machine::Machine(const Program &program, std::size_t size)
+    : program(program), stack(new Value[size]), size(size) {}
+
+Machine::~Machine() {
+  for (Array *a : heap) {
+    delete a;
+  }
+}
+
+Array *Machine::allocate(std::size_t n) {
+  Array *a = new Array;
+  a->items.resize(n);
+  heap.push_back(a);
+  return a;
+}
+
+bool Machine::run(FILE *diagnostics) {
+  std::vector<Frame> frames;
+  const Function *fn = &program.functions[0];
+  const Instr *pc = fn->code.data();
+  Value *base = stack.get(), *end = stack.get() + size;
+  const char *error = nullptr;
+
+  if (base + fn->frame > end) {
+    error = "stack overflow";
+    goto failed;
+  }
+  base[0].p = nullptr;
+
+#define A base[pc->a]
+#define B base[pc->b]
+#define C base[pc->c]
+#define FAIL(message)                                                          \
+  do {                                                                         \
+    error = message;                                                           \
+    goto failed;                                                               \
+  } while (0)
+
+#ifdef __GNUC__
+  // each operation jumps straight to the next one through this table
+  static void *const labels[] = {
+#define VM_LABEL(name) &&do_##name,
+      VM_OPERATIONS(VM_LABEL)
+#undef VM_LABEL
+  };
+#define DISPATCH() goto *labels[pc->op]
+#define OP(name) do_##name:
+  DISPATCH();
+#else
+#define DISPATCH() goto dispatch
+#define OP(name) case name:
+dispatch:
+  switch (pc->op) {
+#endif
+#define NEXT()                                                                 \
+  ++pc;                                                                        \
+  DISPATCH()
+
+  OP(MOVE) {
+    A = B;
+    NEXT();
+  }
+  OP(LOADI) {
+    A.i = pc->k();
+    NEXT();
+  }
+  OP(LOADK) {
+    A = program.constants[pc->b];
+    NEXT();
+  }
+  OP(LOADS) {
+    const std::string &s = program.strings[pc->b];
+    Array *a = allocate(s.size());
+    for (std::size_t i = 0; i < s.size(); ++i) {
+      a->items[i].i = static_cast<unsigned char>(s[i]);
+    }
+    A.a = a;
+    NEXT();
+  }
+  OP(LOADUP) {
+    Value *frame = base;
+    for (int n = pc->x; n > 0; --n) {
+      frame = frame[0].p;
+    }
+    A = frame[pc->b];
+    NEXT();
+  }
+  OP(STOREUP) {
+    Value *frame = base;
+    for (int n = pc->x; n > 0; --n) {
+      frame = frame[0].p;
+    }
+    frame[pc->b] = A;
+    NEXT();
+  }
+  OP(ADDRUP) {
+    Value *frame = base;
+    for (int n = pc->x; n > 0; --n) {
+      frame = frame[0].p;
+    }
+    A.p = &frame[pc->b];
+    NEXT();
+  }
+  OP(ADDR) {
+    A.p = &B;
+    NEXT();
+  }
+  OP(ADDRIDX) {
+    Array *a = B.a;
+    std::int64_t i = C.i;
+    if (i < 0 || i >= static_cast<std::int64_t>(a->items.size())) {
+      FAIL("index out of bounds");
+    }
+    // appending to the array later may move its items, as in C
+    A.p = &a->items[i];
+    NEXT();
+  }
+  OP(LOAD) {
+    if (B.p == nullptr) {
+      FAIL("null reference");
+    }
+    A = *B.p;
+    NEXT();
+  }
+  OP(STORE) {
+    if (A.p == nullptr) {
+      FAIL("null reference");
+    }
+    *A.p = B;
+    NEXT();
+  }
+  OP(NEWARR) {
+    A.a = allocate(pc->k());
+    NEXT();
+  }
+  OP(INDEX) {
+    Array *a = B.a;
+    std::int64_t i = C.i;
+    if (i < 0 || i >= static_cast<std::int64_t>(a->items.size())) {
+      FAIL("index out of bounds");
+    }
+    A = a->items[i];
+    NEXT();
+  }
+  OP(SETIDX) {
+    Array *a = A.a;
+    std::int64_t i = B.i;
+    if (i < 0 || i >= static_cast<std::int64_t>(a->items.size())) {
+      FAIL("index out of bounds");
+    }
+    a->items[i] = C;
+    NEXT();
+  }
+  OP(APPEND) {
+    A.a->items.push_back(B);
+    NEXT();
+  }
+  OP(LEN) {
+    A.i = B.a->items.size();
+    NEXT();
+  }
+  OP(CONCAT) {
+    const std::vector<Value> &l = B.a->items, &r = C.a->items;
+    Array *a = allocate(0);
+    a->items.reserve(l.size() + r.size());
+    a->items.insert(a->items.end(), l.begin(), l.end());
+    a->items.insert(a->items.end(), r.begin(), r.end());
+    A.a = a;
+    NEXT();
+  }
+  OP(CMPARR) {
+    const std::vector<Value> &l = B.a->items, &r = C.a->items;
+    std::size_t n = (l.size() < r.size()) ? l.size() : r.size(), i = 0;
+    int order = 0;
+    for (; i < n && order == 0; ++i) {
+      if (pc->x) {
+        order = (l[i].f < r[i].f) ? -1 : (l[i].f > r[i].f);
+      } else {
+        order = (l[i].i < r[i].i) ? -1 : (l[i].i > r[i].i);
+      }
+    }
+    if (order == 0) {
+      order = (l.size() < r.size()) ? -1 : (l.size() > r.size());
+    }
+    A.i = order;
+    NEXT();
+  }
+  OP(ADDI) {
+    A.i = _wrap(std::uint64_t(B.i) + std::uint64_t(C.i));
+    NEXT();
+  }
+  OP(SUBI) {
+    A.i = _wrap(std::uint64_t(B.i) - std::uint64_t(C.i));
+    NEXT();
+  }
+  OP(MULI) {
+    A.i = _wrap(std::uint64_t(B.i) * std::uint64_t(C.i));
+    NEXT();
+  }
+  OP(DIVI) {
+    std::int64_t d = C.i;
+    if (d == 0) {
+      FAIL("division by zero");
+    }
+    A.i = (d == -1) ? _wrap(0 - std::uint64_t(B.i)) : B.i / d;
+    NEXT();
+  }
+  OP(NEGI) {
+    A.i = _wrap(0 - std::uint64_t(B.i));
+    NEXT();
+  }
+  OP(ADDF) {
+    A.f = B.f + C.f;
+    NEXT();
+  }
+  OP(SUBF) {
+    A.f = B.f - C.f;
+    NEXT();
+  }
+  OP(MULF) {
+    A.f = B.f * C.f;
+    NEXT();
+  }
+  OP(DIVF) {
+    if (C.f == 0) {
+      FAIL("division by zero");
+    }
+    A.f = B.f / C.f;
+    NEXT();
+  }
+  OP(NEGF) {
+    A.f = -B.f;
+    NEXT();
+  }
+  OP(EQI) {
+    A.i = B.i == C.i;
+    NEXT();
+  }
+  OP(NEI) {
+    A.i = B.i != C.i;
+    NEXT();
+  }
+  OP(LTI) {
+    A.i = B.i < C.i;
+    NEXT();
+  }
+  OP(LEI) {
+    A.i = B.i <= C.i;
+    NEXT();
+  }
+  OP(GTI) {
+    A.i = B.i > C.i;
+    NEXT();
+  }
+  OP(GEI) {
+    A.i = B.i >= C.i;
+    NEXT();
+  }
+  OP(EQF) {
+    A.i = B.f == C.f;
+    NEXT();
+  }
+  OP(NEF) {
+    A.i = B.f != C.f;
+    NEXT();
+  }
+  OP(LTF) {
+    A.i = B.f < C.f;
+    NEXT();
+  }
+  OP(LEF) {
+    A.i = B.f <= C.f;
+    NEXT();
+  }
+  OP(GTF) {
+    A.i = B.f > C.f;
+    NEXT();
+  }
+  OP(GEF) {
+    A.i = B.f >= C.f;
+    NEXT();
+  }
+  OP(AND) {
+    A.i = B.i & C.i;
+    NEXT();
+  }
+  OP(OR) {
+    A.i = B.i | C.i;
+    NEXT();
+  }
+  OP(NOT) {
+    A.i = !B.i;
+    NEXT();
+  }
+  OP(ITOF) {
+    A.f = static_cast<double>(B.i);
+    NEXT();
+  }
+  OP(FTOI) {
+    double f = B.f;
+    if (!(f >= -9223372036854775808.0 && f < 9223372036854775808.0)) {
+      FAIL("float out of the range of integers");
+    }
+    A.i = static_cast<std::int64_t>(f);
+    NEXT();
+  }
+  OP(ITOB) {
+    A.i = B.i != 0;
+    NEXT();
+  }
+  OP(FTOB) {
+    A.i = B.f != 0;
+    NEXT();
+  }
+  OP(CTOS) {
+    Array *a = allocate(1);
+    a->items[0] = B;
+    A.a = a;
+    NEXT();
+  }
+  OP(ITOS) {
+    char text[24];
+    int n = std::snprintf(text, sizeof(text), "%lld",
+                          static_cast<long long>(B.i));
+    Array *a = allocate(n);
+    for (int i = 0; i < n; ++i) {
+      a->items[i].i = text[i];
+    }
+    A.a = a;
+    NEXT();
+  }
+  OP(JUMP) {
+    pc = fn->code.data() + pc->k();
+    DISPATCH();
+  }
+  OP(JUMPF) {
+    if (!A.i) {
+      pc = fn->code.data() + pc->k();
+      DISPATCH();
+    }
+    NEXT();
+  }
+  OP(JUMPT) {
+    if (A.i) {
+      pc = fn->code.data() + pc->k();
+      DISPATCH();
+    }
+    NEXT();
+  }
+  OP(CALL) {
+    const Function &f = program.functions[pc->b];
+    Value *callee = base + fn->frame;
+    if (callee + f.frame > end) {
+      FAIL("stack overflow");
+    }
+    Value *link = base;
+    for (int n = pc->x; n > 0; --n) {
+      link = link[0].p;
+    }
+    callee[0].p = link;
+    for (int i = 0; i < f.params; ++i) {
+      callee[1 + i] = base[pc->a + i];
+    }
+    frames.push_back({pc, base, fn});
+    base = callee;
+    fn = &f;
+    pc = f.code.data();
+    DISPATCH();
+  }
+  OP(RET) {
+    Value v = A;
+    const Frame &caller = frames.back();
+    pc = caller.pc;
+    base = caller.base;
+    fn = caller.function;
+    frames.pop_back();
+    A = v;
+    NEXT();
+  }
+  OP(HALT) { return true; }
+
+#ifndef __GNUC__
+  }
+#endif
+#undef A
+#undef B
+#undef C
+#undef FAIL
+#undef DISPATCH
+#undef OP
+#undef NEXT
+
+failed:
+  std::fprintf(diagnostics, "runtime error: %s", error);
+  if (!fn->name.empty()) {
+    std::fprintf(diagnostics, " in function %s", fn->name.c_str());
+  }
+  std::fprintf(diagnostics, "\n");
+  return false;
+}
+
+void Machine::dump(FILE *out) const {
+  for (const Global &g : program.globals) {
+    std::fprintf(out, "%s = ", g.name->c_str());
+    print(out, stack[g.reg], g.type);
+    std::fprintf(out, "\n");
+  }
+}
+
+void Machine::print(FILE *out, Value v, int type) const {
+  if (type % 8 >= 4) {
+    const std::vector<Value> &items = v.a->items;
+    if (type == AST::A_CHAR) {
+      std::fprintf(out, "\"");
+      for (const Value &c : items) {
+        std::fputc(static_cast<int>(c.i), out);
+      }
+      std::fprintf(out, "\"");
+      return;
+    }
+    std::fprintf(out, "[");
+    for (std::size_t i = 0; i < items.size(); ++i) {
+      std::fprintf(out, (i > 0) ? ", " : "");
+      print(out, items[i], type - 4);
+    }
+    std::fprintf(out, "]");
+  } else if (type >= 8) {
+    std::fprintf(out, (v.p != nullptr) ? "ref" : "null");
+  } else if (type == AST::FLOAT) {
+    _real(out, v.f);
+  } else if (type == AST::BOOL) {
+    std::fprintf(out, v.i ? "true" : "false");
+  } else if (type == AST::CHAR) {
+    std::fprintf(out, "'%c'", static_cast<int>(v.i));
+  } else {
+    std::fprintf(out, "%lld", static_cast<long long>(v.i));
+  }
+}
+
+} // namespace VM
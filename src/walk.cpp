@@ -0,0 +1,64 @@
+#include "walk.h"
+
+namespace AST {
+namespace Walk {
+
+/* Nodes walked in place, one inside the other, before the walk moves to
+   the stack; deeper walks are rare, and each level costs a few frames
+   of the native stack. */
+static const int _budget = 128;
+
+/* Steps left on this thread, the next one on top; walks nested in place
+   around the running step; the node it visits, if that has not walked
+   yet; and the values handed between steps. */
+static thread_local std::vector<Step> _stack;
+static thread_local int _depth = 0;
+static thread_local const Node *_visited = nullptr;
+static thread_local std::vector<int> _values;
+
+/* Runs steps in place while the walk is shallow. Past that, pushes them
+   so that the first one is on top, and runs them unless they take the
+   place of the step visiting their node. */
+template <typename It>
+static bool _run(const Node *self, It first, It last) {
+  bool later = (self != nullptr && self == _visited);
+  _visited = nullptr;
+  if (!later && _depth < _budget) {
+    ++_depth;
+    for (It s = first; s != last; ++s) {
+      s->work(*s);
+    }
+    --_depth;
+    return false;
+  }
+
+  std::vector<Step> &stack = _stack;
+  std::size_t base = stack.size();
+  while (last != first) {
+    stack.push_back(*--last);
+  }
+  if (later) {
+    return true;
+  }
+  while (stack.size() > base) {
+    Step s = stack.back();
+    stack.pop_back();
+    _visited = s.visits ? s.node : nullptr;
+    s.work(s);
+    _visited = nullptr;
+  }
+  return false;
+}
+
+bool run(const Node *self, std::initializer_list<Step> steps) {
+  return _run(self, steps.begin(), steps.end());
+}
+
+bool run(const Node *self, const std::vector<Step> &steps) {
+  return _run(self, steps.begin(), steps.end());
+}
+
+std::vector<int> &values() { return _values; }
+
+} // namespace Walk
+} // namespace AST
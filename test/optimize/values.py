@@ -0,0 +1,23 @@
+"""Runs the Python of a program read from stdin and prints the values it
+leaves in `main`, with their types, so that runs can be compared. Names
+of variables in inner blocks are printed without the number of their
+block, which dropping branches may change."""
+
+import re
+import sys
+
+
+def values(frame, event, arg):
+    if event == "return" and frame.f_code.co_name == "main":
+        found = dict(frame.f_globals)
+        found.update(frame.f_locals)
+        for name, value in sorted(
+                (re.sub(r"__s[0-9]+$", "", k), repr(v))
+                for k, v in found.items() if not k.startswith("__") and
+                type(v) in (bool, int, float, str, list)):
+            print(name + " = " + value)
+
+
+source = sys.stdin.read()
+sys.setprofile(values)
+exec(compile(source, "<stdin>", "exec"), {"__name__": "__main__"})
@@ -0,0 +1,7 @@
+"""Expressions nested 100k parentheses deep, both through binary and
+unary operations, which must be parsed and walked without recursion."""
+
+n = 100000
+print("int a, b")
+print("a = " + "(" * n + "a" + " + 1)" * n)
+print("b = " + "-(" * n + "b" + ")" * n)
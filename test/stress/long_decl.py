@@ -0,0 +1,7 @@
+"""Line declaring a million variables, some of them initialized, whose
+chain of declarations must be walked without recursion."""
+
+n = 1000000
+print("int " + ", ".join("v%d = %d" % (i, i) if i % 10 == 0 else "v%d" % i
+                         for i in range(n)))
+print("v%d = v%d + v1" % (n - 1, n // 2))
@@ -0,0 +1,5 @@
+"""Expression with 100k terms, building a left-leaning chain of additions
+whose types must be computed in linear time."""
+
+print("int a, b")
+print("a = " + " + ".join(["a", "b"] * 50000))
@@ -1,11 +1,14 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
+def main():
+    a = 0
+    b = 0
+    c = 0
+    f = 3.4
+    a = 2
+    b = 4
+    def λ(x, y):
+        return (x + y)
 
+    c = λ(a, int(f))
 
 
-f = 3.4
-a = 2
-b = 4
-def λ(x, y):
-    return (x + y)
-
-c = λ(a, int(f))
+main()
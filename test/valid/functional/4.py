@@ -1,15 +1,18 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
+def main():
+    a = 0
+    b = 0
+    c = 0
+    d = 0
+    a = 2
+    b = 4
+    def λ(x, y):
+        return (x + y)
 
+    c = λ(a, b)
+    def λ(x, y):
+        return (x - y)
 
+    d = λ(a, b)
 
 
-a = 2
-b = 4
-def λ(x, y):
-    return (x + y)
-
-c = λ(a, b)
-def λ(x, y):
-    return (x - y)
-
-d = λ(a, b)
+main()
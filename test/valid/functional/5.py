@@ -1,19 +1,20 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
-t = [0] * 10
+def main():
+    t = [0] * 10
+    output = 0
+    def t_fold(t):
+        def λ(x, y):
+            return (x + y)
 
-def t_fold(t):
-    def λ(x, y):
-        return (x + y)
+        t_tv__s4 = 0
+        t_tv__s4 = t[0]
+        t_ti__s4 = 0
+        t_ti__s4 = 1
+        while (t_ti__s4 < len(t)):
+            t_tv__s4 = (t_tv__s4 + λ(t_tv__s4, t[t_ti__s4]))
+            t_ti__s4 = (t_ti__s4 + 1)
+        return t_tv__s4
 
-        
-    t_tv = t[0]
-    
-    s_context()
-    t_ti = 1
-    while (t_ti < len(t)):
-        t_tv = (t_tv + λ(t_tv, t[t_ti]))
-        t_ti = (t_ti + 1)
-    r_context()
-    return t_tv
+    output = t_fold(t)
 
-output = t_fold(t)
+
+main()
@@ -1,21 +1,20 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
-t = [0] * 10
-output = [0] * 10
-def t_filter(t):
-    def λ(x):
-        return (x > 10)
+def main():
+    t = [0] * 10
+    output = [0] * 10
+    def t_filter(t):
+        def λ(x):
+            return (x > 10)
 
-        
-    t_ta = [0] * 0
-    s_context()
-    t_ti = 0
-    while (t_ti < len(t)):
-        s_context()
-        if λ(t[t_ti]):
-            t_ta + [t[t_ti]]
-        r_context()
-        t_ti = (t_ti + 1)
-    r_context()
-    return t_ta
+        t_ti__s4 = 0
+        t_ta__s4 = [0] * 0
+        t_ti__s4 = 0
+        while (t_ti__s4 < len(t)):
+            if λ(t[t_ti__s4]):
+                t_ta__s4 = t_ta__s4 + [t[t_ti__s4]]
+            t_ti__s4 = (t_ti__s4 + 1)
+        return t_ta__s4
 
-output = t_filter(t)
+    output = t_filter(t)
+
+
+main()
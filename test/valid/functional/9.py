@@ -1,4 +1,7 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
-def λ(x):
-    return (x + 1)
+def main():
+    def λ(x):
+        return (x + 1)
 
+
+
+main()
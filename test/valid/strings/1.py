@@ -1,2 +1,5 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
-a = '/'
+def main():
+    a = '/'
+
+
+main()
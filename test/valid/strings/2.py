@@ -1,7 +1,10 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
-let = 'a'
-wd = [0] * 4
-result = [0] * 10
-wd = "luka"
-result = (wd + str(let))
-let = result[1]
+def main():
+    let = 'a'
+    wd = ['\0'] * 4
+    result = ['\0'] * 10
+    wd = "luka"
+    result = (wd + str(let))
+    let = result[1]
+
+
+main()
@@ -1,5 +1,8 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
+def main():
+    a = '\0'
+    b = '\0'
+    a = 'a'
+    b = a
 
 
-a = 'a'
-b = a
+main()
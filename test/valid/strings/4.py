@@ -1,6 +1,9 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
-b = [0] * 10
-b = "teste"
-b = ""
-b = str('a')
-b = ("um" + str('a'))
+def main():
+    b = ['\0'] * 10
+    b = "teste"
+    b = ""
+    b = str('a')
+    b = ("um" + str('a'))
+
+
+main()
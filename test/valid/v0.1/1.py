@@ -1,9 +1,12 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
+def main():
+    a_ = 0
+    BB = 0
+    c = 0
+    d = 0
+    e1 = 1
+    a_ = (d + (2 * 3))
+    BB = ((-a_ / 12) - 1)
+    c = ((e1 * e1) / a_)
 
 
-
-d = 0
-e1 = 1
-a_ = (d + (2 * 3))
-BB = ((-a_ / 12) - 1)
-c = ((e1 * e1) / a_)
+main()
@@ -1,6 +1,9 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
-Abra = 1
+def main():
+    Abra = 1
+    Kadabra = 0
+    Alakazam = 0
+    Kadabra = ((Abra * 10) + 1)
+    Alakazam = (1 + (Kadabra * 10))
 
 
-Kadabra = ((Abra * 10) + 1)
-Alakazam = (1 + (Kadabra * 10))
+main()
@@ -1,3 +1,6 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
+def main():
+    x10_12Y = 0
+    x10_12Y = ((-(10 + 2) * (3 - 4)) / (-0 + 1))
 
-x10_12Y = ((-(10 + 2) * (3 - 4)) / (-0 + 1))
+
+main()
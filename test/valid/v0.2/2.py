@@ -1,4 +1,7 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
+def main():
+    ab = False
+    cd = True
+    ab = ((cd | (not True)) & (2 > -2))
 
-cd = True
-ab = ((cd | (not True)) & (2 > -2))
+
+main()
@@ -1,7 +1,10 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
+def main():
+    abba = 0.0
+    ikea = 0.0
+    abba = 12.0
+    ikea = ((13.21 * 1.7) + 4.2)
+    svenska = False
+    svenska = (abba <= ikea)
 
 
-abba = 12.0
-ikea = ((13.21 * 1.7) + 4.2)
-
-svenska = (abba <= ikea)
+main()
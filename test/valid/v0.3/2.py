@@ -1,5 +1,8 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
-i = 0
-f = float(0)
-f = (float((12 + i)) - f)
-i = int((float(int(12.3)) / f))
+def main():
+    i = 0
+    f = float(0)
+    f = (float((12 + i)) - f)
+    i = int((float(int(12.3)) / f))
+
+
+main()
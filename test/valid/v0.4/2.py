@@ -1,14 +1,11 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
+def main():
+    f = 0.0
+    if True:
+        if (2.3 <= float(4)):
+            if ((2 + 3) >= 5):
+                f = 2.0
+        else:
+            f = 1.0
 
-s_context()
-if True:
-    s_context()
-    if (2.3 <= float(4)):
-        s_context()
-        if ((2 + 3) >= 5):
-            f = 2.0
-        r_context()
-    else:
-        f = 1.0
-    r_context()
-r_context()
+
+main()
@@ -1,16 +1,15 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
+def main():
+    i = 0
+    j = 0
+    while (j < 10):
+        j = (j + 2)
+    i = 0
+    while (i < 10):
+        temp__s3 = 0
+        temp__s3 = (j + i)
+        j = temp__s3
+        i = (i + 1)
+    j = (j + 0)
 
-j = 0
-s_context()
-while (j < 10):
-    j = (j + 2)
-r_context()
-s_context()
-i = 0
-while (i < 10):
-    
-    temp = (j + i)
-    j = temp
-    i = (i + 1)
-r_context()
-j = (j + 0)
+
+main()
@@ -1,13 +1,12 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
+def main():
+    i = 0
+    if True:
+        i__s2 = 0.0
+    i = 0
+    while (i < 2):
+        a__s4 = 0
+        i = (i + 2)
+    a = True
 
-s_context()
-if True:
-    i = 0.0
-r_context()
-s_context()
-i = 0
-while (i < 2):
-    
-    i = (i + 2)
-r_context()
-a = True
+
+main()
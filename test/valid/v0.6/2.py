@@ -1,16 +1,13 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
+def main():
+    i = 0
+    j = 0
+    if True:
+        i__s2 = 0
+        if True:
+            i__s2 = 0
+            while (i__s2 < 10):
+                j__s4 = 0
+                i__s2 = (i__s2 + 3)
 
 
-s_context()
-if True:
-    
-    s_context()
-    if True:
-        s_context()
-        i = 0
-        while (i < 10):
-            
-            i = (i + 3)
-        r_context()
-    r_context()
-r_context()
+main()
@@ -1,14 +1,15 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
-def f():
-    return False
-
-s_context()
-if f():
-    a = 0
-    def f2(x):
-        
-        a = (x + 1)
-        return a
-
-    a = f2(a)
-r_context()
+def main():
+    def f():
+        return False
+
+    if f():
+        a__s3 = 0
+        def f2(x):
+            a__s5 = 0
+            a__s5 = (x + 1)
+            return a__s5
+
+        a__s3 = f2(a__s3)
+
+
+main()
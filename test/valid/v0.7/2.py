@@ -1,13 +1,14 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
-def fibo(x, b):
-    
-    s_context()
-    if (x < 2):
-        ans = x
-    else:
-        ans = (fibo((x - 1), b) + fibo((x - 2), b))
-    r_context()
-    return ans
+def main():
+    def fibo(x, b):
+        ans = 0
+        if (x < 2):
+            ans = x
+        else:
+            ans = (fibo((x - 1), b) + fibo((x - 2), b))
+        return ans
 
+    a = 0
+    a = fibo(10, True)
 
-a = fibo(10, True)
+
+main()
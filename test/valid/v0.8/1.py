@@ -1,16 +1,15 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
-a = [0] * 10
-parity = [0] * 10
+def main():
+    a = [0] * 10
+    parity = [False] * 10
+    i = 0
+    i = 0
+    while (i < 10):
+        a[i] = i
+        if ((a[i] / 2) == 0):
+            parity[i] = True
+        else:
+            parity[i] = False
+        i = (i + 1)
 
-s_context()
-i = 0
-while (i < 10):
-    a[i] = i
-    s_context()
-    if ((a[i] / 2) == 0):
-        parity[i] = True
-    else:
-        parity[i] = False
-    r_context()
-    i = (i + 1)
-r_context()
+
+main()
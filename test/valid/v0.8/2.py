@@ -1,3 +1,6 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
-values = [0] * 100
-values[(int(values[10]) + 2)] = -values[(int(values[12]) * 5)]
+def main():
+    values = [0.0] * 100
+    values[(int(values[10]) + 2)] = -values[(int(values[12]) * 5)]
+
+
+main()
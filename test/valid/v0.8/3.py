@@ -1,3 +1,6 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
-values = [0] * 100
-vars = [0] * 10
+def main():
+    values = [0.0] * 100
+    vars = [0.0] * 10
+
+
+main()
@@ -1,11 +1,14 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
-a = [0] * 10
-i = 0
+def main():
+    a = [0] * 10
+    i = 0
+    mypointer = 0
+    pointers = [0] * 2
+    mypointer = i
+    i = (mypointer + 1)
+    pointers[0] = mypointer
+    pointers[1] = a[3]
+    doublepointer = 0
+    doublepointer = pointers[0]
 
-pointers = [0] * 2
-mypointer = i
-i = (mypointer + 1)
-pointers[0] = mypointer
-pointers[1] = a[3]
 
-doublepointer = pointers[0]
+main()
@@ -1,8 +1,11 @@
-exec(open('../../../src/scope_manager.py', 'r').read())
-i = 0
-j = 2
+def main():
+    i = 0
+    j = 2
+    ip = 0
+    jp = 0
+    ip = i
+    jp = j
+    ip = jp
 
 
-ip = i
-jp = j
-ip = jp
+main()